@@ -7,7 +7,34 @@
 #include "ElfUtils.h"
 #include "elfio/elfio.hpp"
 
-bool ElfUtils::doRelocation(const std::vector<RelocationData> &relocData, relocation_trampoline_entry_t *tramp_data, uint32_t tramp_length, std::map<std::string, OSDynLoad_Module> &usedRPls) {
+void RelocationStats::Count(char type) {
+    switch (type) {
+        case R_PPC_ADDR32:
+            counts[KIND_ADDR32]++;
+            break;
+        case R_PPC_ADDR16_LO:
+            counts[KIND_ADDR16_LO]++;
+            break;
+        case R_PPC_ADDR16_HI:
+            counts[KIND_ADDR16_HI]++;
+            break;
+        case R_PPC_ADDR16_HA:
+            counts[KIND_ADDR16_HA]++;
+            break;
+        case R_PPC_REL24:
+            counts[KIND_REL24]++;
+            break;
+        case R_PPC_REL14:
+            counts[KIND_REL14]++;
+            break;
+        default:
+            counts[KIND_OTHER]++;
+            break;
+    }
+}
+
+bool ElfUtils::doRelocation(const std::vector<RelocationData> &relocData, relocation_trampoline_entry_t *tramp_data, uint32_t tramp_length, std::map<std::string, OSDynLoad_Module> &usedRPls,
+                            RelocationStats *stats) {
     for (auto const &curReloc : relocData) {
         std::string functionName   = curReloc.getName();
         std::string rplName        = curReloc.getImportRPLInformation()->getRPLName();
@@ -36,7 +63,7 @@ bool ElfUtils::doRelocation(const std::vector<RelocationData> &relocData, reloca
             return false;
         }
         if (!ElfUtils::elfLinkOne(curReloc.getType(), curReloc.getOffset(), curReloc.getAddend(), (uint32_t) curReloc.getDestination(), functionAddress, tramp_data, tramp_length,
-                                  RELOC_TYPE_IMPORT)) {
+                                  RELOC_TYPE_IMPORT, stats)) {
             DEBUG_FUNCTION_LINE_ERR("Relocation failed\n");
             return false;
         }
@@ -49,10 +76,13 @@ bool ElfUtils::doRelocation(const std::vector<RelocationData> &relocData, reloca
 
 // See https://github.com/decaf-emu/decaf-emu/blob/43366a34e7b55ab9d19b2444aeb0ccd46ac77dea/src/libdecaf/src/cafe/loader/cafe_loader_reloc.cpp#L144
 bool ElfUtils::elfLinkOne(char type, size_t offset, int32_t addend, uint32_t destination, uint32_t symbol_addr, relocation_trampoline_entry_t *trampoline_data, uint32_t trampoline_data_length,
-                          RelocationType reloc_type) {
+                          RelocationType reloc_type, RelocationStats *stats) {
     if (type == R_PPC_NONE) {
         return true;
     }
+    if (stats) {
+        stats->Count(type);
+    }
 
     auto target = destination + offset;
     auto value  = symbol_addr + addend;
@@ -161,6 +191,9 @@ bool ElfUtils::elfLinkOne(char type, size_t offset, int32_t addend, uint32_t des
                     freeSlot->trampoline[3] = 0x4E800420;                                             // bctr
                     ICInvalidateRange((unsigned char *) freeSlot->trampoline, sizeof(freeSlot->trampoline));
 
+                    if (stats) {
+                        stats->trampolines++;
+                    }
                     if (reloc_type == RELOC_TYPE_FIXED) {
                         freeSlot->status = RELOC_TRAMP_FIXED;
                     } else {
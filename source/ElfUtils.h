@@ -45,11 +45,32 @@ extern "C" {
 }
 #endif
 
+// Counts the relocations applied to a module, see BootReport.
+struct RelocationStats {
+    enum Kind {
+        KIND_ADDR32,
+        KIND_ADDR16_LO,
+        KIND_ADDR16_HI,
+        KIND_ADDR16_HA,
+        KIND_REL24,
+        KIND_REL14,
+        KIND_OTHER,
+        KIND_COUNT,
+    };
+
+    uint32_t counts[KIND_COUNT] = {};
+    //! Branches that had to go through a trampoline.
+    uint32_t trampolines = 0;
+
+    void Count(char type);
+};
+
 class ElfUtils {
 
 public:
     static bool elfLinkOne(char type, size_t offset, int32_t addend, uint32_t destination, uint32_t symbol_addr, relocation_trampoline_entry_t *trampolin_data, uint32_t trampolin_data_length,
-                           RelocationType reloc_type);
+                           RelocationType reloc_type, RelocationStats *stats = nullptr);
 
-    static bool doRelocation(const std::vector<RelocationData> &relocData, relocation_trampoline_entry_t *tramp_data, uint32_t tramp_length, std::map<std::string, OSDynLoad_Module> &usedRPls);
+    static bool doRelocation(const std::vector<RelocationData> &relocData, relocation_trampoline_entry_t *tramp_data, uint32_t tramp_length, std::map<std::string, OSDynLoad_Module> &usedRPls,
+                             RelocationStats *stats = nullptr);
 };
@@ -0,0 +1,109 @@
+#include "BinaryFile.h"
+#include "utils/FileUtils.h"
+#include "utils/logger.h"
+#include <cstdio>
+#include <cstdlib>
+
+BinaryFileReader::~BinaryFileReader() {
+    free(mBuffer);
+}
+
+bool BinaryFileReader::Load(const std::string &path, uint32_t headerSize) {
+    free(mBuffer);
+    mBuffer = nullptr;
+    mSize   = 0;
+    if (LoadFileToMem(path.c_str(), &mBuffer, &mSize) < 0) {
+        DEBUG_FUNCTION_LINE_VERBOSE("%s not found at %s", mName, path.c_str());
+        return false;
+    }
+    if (mSize < headerSize) {
+        DEBUG_FUNCTION_LINE_WARN("%s is too small", mName);
+        return false;
+    }
+    mHeaderSize = headerSize;
+    return true;
+}
+
+bool BinaryFileReader::CheckHeader(uint32_t magic, uint32_t version, uint32_t expectedMagic, uint32_t expectedVersion) const {
+    if (magic != expectedMagic || version != expectedVersion) {
+        DEBUG_FUNCTION_LINE_WARN("%s has unexpected magic or version", mName);
+        return false;
+    }
+    return true;
+}
+
+bool BinaryFileReader::SetLayout(std::initializer_list<BinaryFileSection> sections, uint32_t stringTableSize, uint64_t trailingSize) {
+    uint64_t expectedSize = mHeaderSize + (uint64_t) stringTableSize + trailingSize;
+    for (auto const &section : sections) {
+        expectedSize += (uint64_t) section.count * section.entrySize;
+    }
+    if (expectedSize != mSize || stringTableSize == 0) {
+        DEBUG_FUNCTION_LINE_WARN("%s has an unexpected size", mName);
+        return false;
+    }
+
+    auto *ptr = mBuffer + mHeaderSize;
+    mSections.clear();
+    for (auto const &section : sections) {
+        mSections.push_back(ptr);
+        ptr += section.count * section.entrySize;
+    }
+    mStringTable     = (const char *) ptr;
+    mStringTableSize = stringTableSize;
+    if (mStringTable[stringTableSize - 1] != '\0') {
+        DEBUG_FUNCTION_LINE_WARN("%s has an invalid string table", mName);
+        return false;
+    }
+    return true;
+}
+
+uint32_t BinaryFileWriter::AddString(const std::string &str) {
+    if (auto it = mStringOffsets.find(str); it != mStringOffsets.end()) {
+        return it->second;
+    }
+    uint32_t offset = mStringTable.size();
+    mStringTable.append(str);
+    mStringTable.push_back('\0');
+    mStringOffsets[str] = offset;
+    return offset;
+}
+
+void BinaryFileWriter::AppendTrailingData(const void *data, uint32_t size) {
+    auto *ptr = reinterpret_cast<const uint8_t *>(data);
+    mTrailingData.insert(mTrailingData.end(), ptr, ptr + size);
+}
+
+bool BinaryFileWriter::Save(const std::string &path, const void *header, uint32_t headerSize) const {
+    uint32_t totalSize = headerSize + GetStringTableSize() + mTrailingData.size();
+    for (auto const &section : mSections) {
+        totalSize += section.size();
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(totalSize);
+    auto *headerPtr = reinterpret_cast<const uint8_t *>(header);
+    out.insert(out.end(), headerPtr, headerPtr + headerSize);
+    for (auto const &section : mSections) {
+        out.insert(out.end(), section.begin(), section.end());
+    }
+    out.insert(out.end(), mStringTable.begin(), mStringTable.end());
+    // Never write an empty string table, this makes validating offsets on load easier.
+    out.push_back('\0');
+    out.insert(out.end(), mTrailingData.begin(), mTrailingData.end());
+
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to open %s for writing", path.c_str());
+        return false;
+    }
+    bool success = fwrite(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    if (!success) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to write %s", mName);
+        remove(path.c_str());
+        return false;
+    }
+
+    DEBUG_FUNCTION_LINE_VERBOSE("Saved %s (%d bytes)", mName, out.size());
+    return true;
+}
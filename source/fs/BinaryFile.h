@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Layout shared by the binary caches of the loader (manifest, icons, boot history):
+ * a header starting with magic and version, tables of fixed size entries, a string table and optional trailing data.
+ * Entries refer to strings by their offset into the string table, which always ends with a '\0'.
+ */
+struct BinaryFileSection {
+    uint32_t count;
+    uint32_t entrySize;
+};
+
+class BinaryFileReader {
+public:
+    //! name is only used for log messages, e.g. "Boot history".
+    explicit BinaryFileReader(const char *name) : mName(name) {
+    }
+
+    ~BinaryFileReader();
+
+    BinaryFileReader(const BinaryFileReader &) = delete;
+    BinaryFileReader &operator=(const BinaryFileReader &) = delete;
+
+    //! Reads the whole file with a single read and checks the magic and version of the header.
+    template<typename Header>
+    bool Load(const std::string &path, uint32_t magic, uint32_t version, Header &header) {
+        if (!Load(path, sizeof(Header))) {
+            return false;
+        }
+        memcpy(&header, mBuffer, sizeof(Header));
+        return CheckHeader(header.magic, header.version, magic, version);
+    }
+
+    //! Checks that the file consists exactly of the header, the given sections, the string table and trailingSize bytes,
+    //! and that the string table is terminated. Must be called before accessing the content.
+    bool SetLayout(std::initializer_list<BinaryFileSection> sections, uint32_t stringTableSize, uint64_t trailingSize = 0);
+
+    template<typename T>
+    [[nodiscard]] T GetEntry(uint32_t section, uint32_t index) const {
+        T entry;
+        memcpy(&entry, mSections[section] + (uint64_t) index * sizeof(T), sizeof(T));
+        return entry;
+    }
+
+    //! Returns nullptr if the offset is outside of the string table.
+    [[nodiscard]] const char *GetString(uint32_t offset) const {
+        return offset < mStringTableSize ? mStringTable + offset : nullptr;
+    }
+
+    [[nodiscard]] const uint8_t *GetTrailingData() const {
+        return (const uint8_t *) mStringTable + mStringTableSize;
+    }
+
+private:
+    bool Load(const std::string &path, uint32_t headerSize);
+
+    bool CheckHeader(uint32_t magic, uint32_t version, uint32_t expectedMagic, uint32_t expectedVersion) const;
+
+    const char *mName;
+    uint8_t *mBuffer     = nullptr;
+    uint32_t mSize       = 0;
+    uint32_t mHeaderSize = 0;
+    std::vector<const uint8_t *> mSections;
+    const char *mStringTable  = nullptr;
+    uint32_t mStringTableSize = 0;
+};
+
+class BinaryFileWriter {
+public:
+    //! name is only used for log messages, e.g. "Boot history".
+    BinaryFileWriter(const char *name, uint32_t sectionCount) : mName(name), mSections(sectionCount) {
+    }
+
+    template<typename T>
+    void AppendEntry(uint32_t section, const T &entry) {
+        auto *ptr = reinterpret_cast<const uint8_t *>(&entry);
+        mSections[section].insert(mSections[section].end(), ptr, ptr + sizeof(T));
+    }
+
+    //! Adds str to the string table and returns its offset. Every string is only stored once.
+    uint32_t AddString(const std::string &str);
+
+    void AppendTrailingData(const void *data, uint32_t size);
+
+    //! Size of the string table as it will be written, this belongs into the header.
+    [[nodiscard]] uint32_t GetStringTableSize() const {
+        return mStringTable.size() + 1;
+    }
+
+    //! Writes the header, the sections, the string table and the trailing data with a single write.
+    //! A partially written file is removed.
+    template<typename Header>
+    bool Save(const std::string &path, const Header &header) const {
+        return Save(path, &header, sizeof(Header));
+    }
+
+private:
+    bool Save(const std::string &path, const void *header, uint32_t headerSize) const;
+
+    const char *mName;
+    std::vector<std::vector<uint8_t>> mSections;
+    std::string mStringTable;
+    std::map<std::string, uint32_t> mStringOffsets;
+    std::vector<uint8_t> mTrailingData;
+};
@@ -0,0 +1,195 @@
+#include "BootHistory.h"
+#include "fs/BinaryFile.h"
+#include "utils/logger.h"
+#include <algorithm>
+
+#define BOOT_HISTORY_MAGIC   0x454C4248 // "ELBH"
+#define BOOT_HISTORY_VERSION 2
+
+#define BOOT_HISTORY_MODULE_PREFETCHED (1 << 0)
+
+// Differences below this are noise, e.g. from the sd card, and are never flagged.
+#define BOOT_REGRESSION_MIN_US 1000
+
+namespace {
+    struct BootHistoryHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t bootCount;
+        uint32_t moduleCount;
+        uint32_t stringTableSize;
+    };
+
+    struct BootHistoryBootEntry {
+        uint32_t environmentOffset;
+        uint32_t firstModule;
+        uint32_t moduleCount;
+    };
+
+    struct BootHistoryModuleEntry {
+        uint32_t nameOffset;
+        uint32_t fileSize;
+        uint32_t compressedBytes;
+        uint32_t readUs;
+        uint32_t linkUs;
+        uint32_t entrypointUs;
+        uint32_t flags;
+    };
+
+    enum BootHistorySection {
+        SECTION_BOOTS,
+        SECTION_MODULES,
+        SECTION_COUNT,
+    };
+
+    uint32_t Median(std::vector<uint32_t> &samples) {
+        auto middle = samples.begin() + samples.size() / 2;
+        std::nth_element(samples.begin(), middle, samples.end());
+        return *middle;
+    }
+
+    bool IsRegression(uint32_t current, uint32_t baseline, uint32_t thresholdPercent) {
+        return current > baseline + BOOT_REGRESSION_MIN_US && (uint64_t) current * 100 > (uint64_t) baseline * (100 + thresholdPercent);
+    }
+} // namespace
+
+bool BootHistory::Load() {
+    mBoots.clear();
+
+    BinaryFileReader reader("Boot history");
+    BootHistoryHeader header;
+    if (!reader.Load(mPath, BOOT_HISTORY_MAGIC, BOOT_HISTORY_VERSION, header) ||
+        !reader.SetLayout({{header.bootCount, sizeof(BootHistoryBootEntry)}, {header.moduleCount, sizeof(BootHistoryModuleEntry)}}, header.stringTableSize)) {
+        return false;
+    }
+
+    std::vector<BootHistoryEntry> boots;
+    boots.reserve(header.bootCount);
+    for (uint32_t i = 0; i < header.bootCount; i++) {
+        auto bootEntry    = reader.GetEntry<BootHistoryBootEntry>(SECTION_BOOTS, i);
+        auto *environment = reader.GetString(bootEntry.environmentOffset);
+        if (!environment || bootEntry.firstModule > header.moduleCount || bootEntry.moduleCount > header.moduleCount - bootEntry.firstModule) {
+            DEBUG_FUNCTION_LINE_WARN("Boot history has an invalid boot entry");
+            return false;
+        }
+
+        BootHistoryEntry boot;
+        boot.environment = environment;
+        boot.modules.reserve(bootEntry.moduleCount);
+        for (uint32_t j = bootEntry.firstModule; j < bootEntry.firstModule + bootEntry.moduleCount; j++) {
+            auto moduleEntry = reader.GetEntry<BootHistoryModuleEntry>(SECTION_MODULES, j);
+            auto *name       = reader.GetString(moduleEntry.nameOffset);
+            if (!name) {
+                DEBUG_FUNCTION_LINE_WARN("Boot history has an invalid module entry");
+                return false;
+            }
+            boot.modules.push_back({name, moduleEntry.fileSize, moduleEntry.compressedBytes, moduleEntry.readUs, moduleEntry.linkUs, moduleEntry.entrypointUs,
+                                    (moduleEntry.flags & BOOT_HISTORY_MODULE_PREFETCHED) != 0});
+        }
+        boots.push_back(std::move(boot));
+    }
+
+    mBoots = std::move(boots);
+    DEBUG_FUNCTION_LINE_VERBOSE("Loaded boot history with %d boots", header.bootCount);
+    return true;
+}
+
+bool BootHistory::Save() const {
+    // The same module names show up in every boot, the writer only stores them once.
+    BinaryFileWriter writer("Boot history", SECTION_COUNT);
+    uint32_t moduleCount = 0;
+
+    for (auto const &boot : mBoots) {
+        BootHistoryBootEntry bootEntry = {};
+        bootEntry.environmentOffset    = writer.AddString(boot.environment);
+        bootEntry.firstModule          = moduleCount;
+        bootEntry.moduleCount          = boot.modules.size();
+        writer.AppendEntry(SECTION_BOOTS, bootEntry);
+
+        for (auto const &module : boot.modules) {
+            BootHistoryModuleEntry moduleEntry = {};
+            moduleEntry.nameOffset             = writer.AddString(module.name);
+            moduleEntry.fileSize               = module.fileSize;
+            moduleEntry.compressedBytes        = module.compressedBytes;
+            moduleEntry.readUs                 = module.readUs;
+            moduleEntry.linkUs                 = module.linkUs;
+            moduleEntry.entrypointUs           = module.entrypointUs;
+            moduleEntry.flags                  = module.prefetched ? BOOT_HISTORY_MODULE_PREFETCHED : 0;
+            writer.AppendEntry(SECTION_MODULES, moduleEntry);
+        }
+        moduleCount += boot.modules.size();
+    }
+
+    BootHistoryHeader header = {};
+    header.magic             = BOOT_HISTORY_MAGIC;
+    header.version           = BOOT_HISTORY_VERSION;
+    header.bootCount         = mBoots.size();
+    header.moduleCount       = moduleCount;
+    header.stringTableSize   = writer.GetStringTableSize();
+    return writer.Save(mPath, header);
+}
+
+void BootHistory::FlagRegressions(BootReport &report, uint32_t thresholdPercent) const {
+    if (thresholdPercent == 0) {
+        return;
+    }
+
+    std::vector<uint32_t> readSamples;
+    std::vector<uint32_t> linkSamples;
+    for (auto &metrics : report.GetModules()) {
+        readSamples.clear();
+        linkSamples.clear();
+        const BootHistoryModule *previous = nullptr;
+        for (auto const &boot : mBoots) {
+            if (boot.environment != report.GetEnvironmentName()) {
+                continue;
+            }
+            for (auto const &module : boot.modules) {
+                if (module.name != metrics.name) {
+                    continue;
+                }
+                // Reading on a worker core takes a different amount of time, don't mix these samples.
+                if (module.prefetched == metrics.prefetched) {
+                    readSamples.push_back(module.readUs);
+                    linkSamples.push_back(module.linkUs);
+                }
+                previous = &module;
+                break;
+            }
+        }
+        if (readSamples.empty()) {
+            continue;
+        }
+
+        auto readUs       = (uint32_t) OSTicksToMicroseconds(metrics.readTicks);
+        auto linkUs       = (uint32_t) OSTicksToMicroseconds(metrics.GetLinkTicks());
+        auto readBaseline = Median(readSamples);
+        auto linkBaseline = Median(linkSamples);
+        // Sizes are compared against the latest boot, a module that grew or lost compression is the usual cause.
+        if (IsRegression(readUs, readBaseline, thresholdPercent)) {
+            metrics.regressions |= ModuleBootMetrics::REGRESSION_READ;
+            DEBUG_FUNCTION_LINE_WARN("%s: read took %u us instead of %u us (file size %u -> %u bytes)", metrics.name.c_str(), readUs, readBaseline, previous->fileSize, metrics.fileSize);
+        }
+        if (IsRegression(linkUs, linkBaseline, thresholdPercent)) {
+            metrics.regressions |= ModuleBootMetrics::REGRESSION_LINK;
+            DEBUG_FUNCTION_LINE_WARN("%s: parse and link took %u us instead of %u us (file size %u -> %u bytes, compressed %u -> %u bytes)", metrics.name.c_str(), linkUs, linkBaseline,
+                                     previous->fileSize, metrics.fileSize, previous->compressedBytes, metrics.inflate.compressedBytes);
+        }
+    }
+}
+
+void BootHistory::Add(const BootReport &report, uint32_t maxBoots) {
+    BootHistoryEntry boot;
+    boot.environment = report.GetEnvironmentName();
+    boot.modules.reserve(report.GetModules().size());
+    for (auto const &metrics : report.GetModules()) {
+        boot.modules.push_back({metrics.name, metrics.fileSize, metrics.inflate.compressedBytes, (uint32_t) OSTicksToMicroseconds(metrics.readTicks),
+                                (uint32_t) OSTicksToMicroseconds(metrics.GetLinkTicks()), (uint32_t) OSTicksToMicroseconds(metrics.entrypointTicks),
+                                metrics.prefetched});
+    }
+    mBoots.push_back(std::move(boot));
+
+    if (mBoots.size() > maxBoots) {
+        mBoots.erase(mBoots.begin(), mBoots.end() - maxBoots);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "BootReport.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct BootHistoryModule {
+    std::string name;
+    uint32_t fileSize        = 0;
+    uint32_t compressedBytes = 0;
+    uint32_t readUs          = 0;
+    //! See ModuleBootMetrics::GetLinkTicks
+    uint32_t linkUs       = 0;
+    uint32_t entrypointUs = 0;
+    //! Read on a worker core, such samples are only compared with each other.
+    bool prefetched = false;
+};
+
+struct BootHistoryEntry {
+    std::string environment;
+    std::vector<BootHistoryModule> modules;
+};
+
+/**
+ * Keeps the module timings of the last boots in a single binary file, oldest boot first.
+ * Each boot is compared against the previous boots of the same environment to point out modules that got slower.
+ */
+class BootHistory {
+public:
+    explicit BootHistory(std::string_view path) : mPath(path) {
+    }
+
+    //! Reads the history with a single file read. Returns false if it's missing or invalid.
+    bool Load();
+
+    //! Writes the history back to the sd card.
+    bool Save() const;
+
+    //! Flags every module of the report whose read or link time is more than thresholdPercent above the median of
+    //! the previous boots that read the module the same way (prefetched or not), and logs a warning with the size
+    //! changes that might explain it.
+    void FlagRegressions(BootReport &report, uint32_t thresholdPercent) const;
+
+    //! Appends the report as the latest boot, only the last maxBoots boots are kept.
+    void Add(const BootReport &report, uint32_t maxBoots);
+
+private:
+    std::string mPath;
+    std::vector<BootHistoryEntry> mBoots;
+};
@@ -0,0 +1,99 @@
+#include "BootReport.h"
+#include "utils/logger.h"
+#include <cstdio>
+
+#define BOOT_REPORT_HEADER                                                                             \
+    "environment,module,file_size,compressed_bytes,uncompressed_bytes,prefetched,"                     \
+    "read_us,inflate_us,parse_us,link_us,import_us,wait_us,entrypoint_us,"                             \
+    "reloc_addr32,reloc_addr16_lo,reloc_addr16_hi,reloc_addr16_ha,reloc_rel24,reloc_rel14,reloc_other," \
+    "imports,trampolines,heap_requested,heap_peak_used,regression\n"
+
+namespace {
+    const char *GetRegressionName(uint32_t regressions) {
+        switch (regressions) {
+            case ModuleBootMetrics::REGRESSION_READ:
+                return "read";
+            case ModuleBootMetrics::REGRESSION_LINK:
+                return "link";
+            case ModuleBootMetrics::REGRESSION_READ | ModuleBootMetrics::REGRESSION_LINK:
+                return "read+link";
+            default:
+                return "";
+        }
+    }
+
+    // Names are quoted, they may contain commas.
+    void AppendQuoted(std::string &out, std::string_view str) {
+        out.push_back('"');
+        for (char c : str) {
+            if (c == '"') {
+                out.push_back('"');
+            }
+            out.push_back(c);
+        }
+        out.push_back('"');
+    }
+
+    void AppendRow(std::string &out, std::string_view environment, std::string_view module, const ModuleBootMetrics &metrics) {
+        AppendQuoted(out, environment);
+        out.push_back(',');
+        AppendQuoted(out, module);
+
+        const auto &counts = metrics.relocations.counts;
+        char line[0x200];
+        snprintf(line, sizeof(line), ",%u,%u,%u,%d,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%s\n",
+                 metrics.fileSize, metrics.inflate.compressedBytes, metrics.inflate.uncompressedBytes, metrics.prefetched,
+                 OSTicksToMicroseconds(metrics.readTicks), OSTicksToMicroseconds(metrics.inflate.ticks), OSTicksToMicroseconds(metrics.parseTicks),
+                 OSTicksToMicroseconds(metrics.linkTicks), OSTicksToMicroseconds(metrics.importTicks), OSTicksToMicroseconds(metrics.waitTicks),
+                 OSTicksToMicroseconds(metrics.entrypointTicks),
+                 counts[RelocationStats::KIND_ADDR32], counts[RelocationStats::KIND_ADDR16_LO], counts[RelocationStats::KIND_ADDR16_HI],
+                 counts[RelocationStats::KIND_ADDR16_HA], counts[RelocationStats::KIND_REL24], counts[RelocationStats::KIND_REL14],
+                 counts[RelocationStats::KIND_OTHER], metrics.imports, metrics.relocations.trampolines, metrics.heapRequested, metrics.heapPeakUsed,
+                 GetRegressionName(metrics.regressions));
+        out += line;
+    }
+} // namespace
+
+bool BootReport::Save(const std::string &path) const {
+    ModuleBootMetrics total;
+    std::string out = BOOT_REPORT_HEADER;
+    for (auto const &module : mModules) {
+        AppendRow(out, mEnvironmentName, module.name, module);
+
+        total.fileSize += module.fileSize;
+        total.inflate.compressedBytes += module.inflate.compressedBytes;
+        total.inflate.uncompressedBytes += module.inflate.uncompressedBytes;
+        total.inflate.ticks += module.inflate.ticks;
+        for (uint32_t i = 0; i < RelocationStats::KIND_COUNT; i++) {
+            total.relocations.counts[i] += module.relocations.counts[i];
+        }
+        total.relocations.trampolines += module.relocations.trampolines;
+        total.imports += module.imports;
+        total.heapRequested += module.heapRequested;
+        total.heapPeakUsed += module.heapPeakUsed;
+        total.readTicks += module.readTicks;
+        total.parseTicks += module.parseTicks;
+        total.linkTicks += module.linkTicks;
+        total.importTicks += module.importTicks;
+        total.waitTicks += module.waitTicks;
+        total.entrypointTicks += module.entrypointTicks;
+    }
+    // Empty module name, so the totals can't be mistaken for a module.
+    AppendRow(out, mEnvironmentName, "", total);
+
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to open %s for writing", path.c_str());
+        return false;
+    }
+    bool success = fwrite(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    if (!success) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to write boot report");
+        remove(path.c_str());
+        return false;
+    }
+
+    DEBUG_FUNCTION_LINE_VERBOSE("Saved boot report with %d modules (%d bytes)", mModules.size(), out.size());
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ElfUtils.h"
+#include "utils/wiiu_zlib.hpp"
+#include <coreinit/time.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ModuleBootMetrics {
+    //! Flags for regressions, set by BootHistory.
+    static constexpr uint32_t REGRESSION_READ = 1 << 0;
+    static constexpr uint32_t REGRESSION_LINK = 1 << 1;
+
+    std::string name;
+    uint32_t fileSize = 0;
+    InflateStats inflate;
+    RelocationStats relocations;
+    //! Relocations against imported functions and data.
+    uint32_t imports       = 0;
+    uint32_t heapRequested = 0;
+    //! Used heap right before the entrypoint, nothing is freed before.
+    uint32_t heapPeakUsed = 0;
+
+    //! Reading the file, on a worker core if it was prefetched.
+    OSTime readTicks = 0;
+    bool prefetched  = false;
+    //! Parsing the ELF and creating the heap, without inflating.
+    OSTime parseTicks      = 0;
+    OSTime linkTicks       = 0;
+    OSTime importTicks     = 0;
+    //! Blocked on the prefetch of this module and on background work before the entrypoint.
+    OSTime waitTicks       = 0;
+    OSTime entrypointTicks = 0;
+
+    uint32_t regressions = 0;
+
+    //! Everything between reading the file and calling the entrypoint that depends on the module itself.
+    [[nodiscard]] OSTime GetLinkTicks() const {
+        return parseTicks + inflate.ticks + linkTicks + importTicks;
+    }
+};
+
+/**
+ * Collects metrics of the setup modules run during a boot and writes them as CSV, one row per module and one
+ * row with the totals. The file is overwritten on every boot.
+ */
+class BootReport {
+public:
+    explicit BootReport(std::string_view environmentName) : mEnvironmentName(environmentName) {
+    }
+
+    void AddModule(ModuleBootMetrics &&metrics) {
+        mModules.push_back(std::move(metrics));
+    }
+
+    [[nodiscard]] const std::string &GetEnvironmentName() const {
+        return mEnvironmentName;
+    }
+
+    [[nodiscard]] const std::vector<ModuleBootMetrics> &GetModules() const {
+        return mModules;
+    }
+
+    std::vector<ModuleBootMetrics> &GetModules() {
+        return mModules;
+    }
+
+    //! Formats the whole report in memory and writes it with a single write.
+    bool Save(const std::string &path) const;
+
+private:
+    std::string mEnvironmentName;
+    std::vector<ModuleBootMetrics> mModules;
+};
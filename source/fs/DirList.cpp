@@ -25,24 +25,45 @@
  * for WiiXplorer 2010
  ***************************************************************************/
 #include <algorithm>
+#include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <string>
 #include <strings.h>
-#include <sys/dirent.h>
 #include <sys/stat.h>
 
 #include <fs/DirList.h>
 #include <utils/StringTools.h>
+#include <utils/logger.h>
+
+// FSTime is in microseconds since 01.01.2000
+#define FSTIME_TO_UNIX_SECONDS(t) (((t) / 1000000) + 946684800)
+
+//! FSA doesn't know about devoptab devices, translate the ones the loader uses. Returns false for any other device.
+static BOOL ToFSAPath(const std::string &path, std::string &fsaPath) {
+    if (path.starts_with("fs:/")) {
+        fsaPath.assign(path, 3);
+    } else if (path.starts_with("sd:/")) {
+        fsaPath = "/vol/external01";
+        fsaPath.append(path, 3);
+    } else if (path.starts_with("/")) {
+        fsaPath = path;
+    } else {
+        return false;
+    }
+    return true;
+}
 
 DirList::DirList() {
     Flags  = 0;
     Filter = 0;
     Depth  = 0;
+    Client = -1;
 }
 
 DirList::DirList(const std::string &path, const char *filter, uint32_t flags, uint32_t maxDepth) {
+    Client = -1;
     this->LoadPath(path, filter, flags, maxDepth);
     this->SortList();
 }
@@ -74,98 +95,164 @@ BOOL DirList::LoadPath(const std::string &folder, const char *filter, uint32_t f
         folderpath += '/';
     }
 
-    return InternalLoadPath(folderpath);
+    std::string fsaPath;
+    if (!ToFSAPath(folderpath, fsaPath)) {
+        DEBUG_FUNCTION_LINE_ERR("%s is not on a device known to FSA, fall back to readdir", folderpath.c_str());
+        BOOL res = InternalLoadPathDevoptab(folderpath);
+        FinalizeEntries();
+        return res;
+    }
+
+    // Enumerate via FSA directly, unlike readdir this gives us the size and type of each entry without an additional stat.
+    FSAInit();
+    Client = FSAAddClient(nullptr);
+    if (Client < 0) {
+        return false;
+    }
+
+    BOOL res = InternalLoadPath(folderpath);
+
+    FSADelClient(Client);
+    Client = -1;
+
+    FinalizeEntries();
+    return res;
 }
 
 BOOL DirList::InternalLoadPath(std::string &folderpath) {
     if (folderpath.size() < 3)
         return false;
 
-    struct dirent *dirent = NULL;
-    DIR *dir              = NULL;
+    //! Subfolders are on the same device, so this only fails if LoadPath already fell back to readdir
+    std::string fsaPath;
+    if (!ToFSAPath(folderpath, fsaPath))
+        return false;
 
-    dir = opendir(folderpath.c_str());
+    FSADirectoryHandle dirHandle;
+    if (FSAOpenDir(Client, fsaPath.c_str(), &dirHandle) != FS_ERROR_OK)
+        return false;
+
+    FSADirectoryEntry entry;
+    while (FSAReadDir(Client, dirHandle, &entry) == FS_ERROR_OK) {
+        BOOL isDir = (entry.info.flags & FS_STAT_DIRECTORY) == FS_STAT_DIRECTORY;
+        ProcessEntry(folderpath, entry.name, isDir, isDir ? 0 : entry.info.size, FSTIME_TO_UNIX_SECONDS(entry.info.modified));
+    }
+    FSACloseDir(Client, dirHandle);
+
+    return true;
+}
+
+BOOL DirList::InternalLoadPathDevoptab(std::string &folderpath) {
+    if (folderpath.size() < 3)
+        return false;
+
+    DIR *dir = opendir(folderpath.c_str());
     if (dir == NULL)
         return false;
 
+    struct dirent *dirent = NULL;
+    std::string entryPath;
     while ((dirent = readdir(dir)) != 0) {
-        BOOL isDir           = dirent->d_type & DT_DIR;
-        const char *filename = dirent->d_name;
+        entryPath = folderpath;
+        if (entryPath.back() != '/')
+            entryPath += '/';
+        entryPath += dirent->d_name;
+
+        struct stat st;
+        if (stat(entryPath.c_str(), &st) != 0)
+            continue;
 
-        if (isDir) {
-            if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0)
-                continue;
+        BOOL isDir = S_ISDIR(st.st_mode);
+        ProcessEntry(folderpath, dirent->d_name, isDir, isDir ? 0 : st.st_size, st.st_mtime);
+    }
+    closedir(dir);
 
-            if ((Flags & CheckSubfolders) && (Depth > 0)) {
-                int32_t length = folderpath.size();
-                if (length > 2 && folderpath[length - 1] != '/') {
-                    folderpath += '/';
-                }
-                folderpath += filename;
+    return true;
+}
 
-                Depth--;
-                InternalLoadPath(folderpath);
-                folderpath.erase(length);
-                Depth++;
+void DirList::ProcessEntry(std::string &folderpath, const char *filename, BOOL isDir, uint32_t fileSize, int64_t modifiedTime) {
+    if (isDir) {
+        if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0)
+            return;
+
+        if ((Flags & CheckSubfolders) && (Depth > 0)) {
+            int32_t length = folderpath.size();
+            if (length > 2 && folderpath[length - 1] != '/') {
+                folderpath += '/';
             }
+            folderpath += filename;
 
-            if (!(Flags & Dirs))
-                continue;
-        } else if (!(Flags & Files)) {
-            continue;
+            Depth--;
+            if (Client < 0) {
+                InternalLoadPathDevoptab(folderpath);
+            } else {
+                InternalLoadPath(folderpath);
+            }
+            folderpath.erase(length);
+            Depth++;
         }
 
-        if (Filter) {
-            char *fileext = strrchr(filename, '.');
-            if (!fileext)
-                continue;
+        if (!(Flags & Dirs))
+            return;
+    } else if (!(Flags & Files)) {
+        return;
+    }
+
+    if (Filter) {
+        const char *fileext = strrchr(filename, '.');
+        if (!fileext)
+            return;
 
-            if (StringTools::strtokcmp(fileext, Filter, ",") == 0)
-                AddEntrie(folderpath, filename, isDir);
-        } else {
-            AddEntrie(folderpath, filename, isDir);
-        }
+        if (StringTools::strtokcmp(fileext, Filter, ",") != 0)
+            return;
     }
-    closedir(dir);
 
-    return true;
+    AddEntrie(folderpath, filename, isDir, fileSize, modifiedTime);
 }
 
-void DirList::AddEntrie(const std::string &filepath, const char *filename, BOOL isDir) {
+void DirList::AddEntrie(const std::string &filepath, const char *filename, BOOL isDir, uint32_t fileSize, int64_t modifiedTime) {
     if (!filename)
         return;
 
-    int32_t pos = FileInfo.size();
+    uint32_t filenameLength = strlen(filename);
+    uint32_t pathOffset     = PathArena.size();
 
-    FileInfo.resize(pos + 1);
-
-    FileInfo[pos].FilePath = (char *) malloc(filepath.size() + strlen(filename) + 2);
-    if (!FileInfo[pos].FilePath) {
-        FileInfo.resize(pos);
-        return;
+    if (PathArena.capacity() == 0) {
+        PathArena.reserve(1024);
     }
 
-    sprintf(FileInfo[pos].FilePath, "%s/%s", filepath.c_str(), filename);
-    FileInfo[pos].isDir = isDir;
+    // "<filepath>/<filename>\0"
+    PathArena.insert(PathArena.end(), filepath.begin(), filepath.end());
+    PathArena.push_back('/');
+    PathArena.insert(PathArena.end(), filename, filename + filenameLength + 1);
+
+    DirEntry entry;
+    entry.FilePath     = nullptr;
+    entry.PathOffset   = pathOffset;
+    entry.NameOffset   = filepath.size() + 1;
+    entry.FileSize     = fileSize;
+    entry.ModifiedTime = modifiedTime;
+    entry.isDir        = isDir;
+    FileInfo.push_back(entry);
 }
 
-void DirList::ClearList() {
-    for (uint32_t i = 0; i < FileInfo.size(); ++i) {
-        if (FileInfo[i].FilePath) {
-            free(FileInfo[i].FilePath);
-            FileInfo[i].FilePath = NULL;
-        }
+void DirList::FinalizeEntries() {
+    for (auto &entry : FileInfo) {
+        entry.FilePath = PathArena.data() + entry.PathOffset;
     }
+}
 
+void DirList::ClearList() {
     FileInfo.clear();
     std::vector<DirEntry>().swap(FileInfo);
+    std::vector<char>().swap(PathArena);
 }
 
 const char *DirList::GetFilename(int32_t ind) const {
     if (!valid(ind))
         return "";
 
-    return StringTools::FullpathToFilename(FileInfo[ind].FilePath);
+    return FileInfo[ind].FilePath + FileInfo[ind].NameOffset;
 }
 
 static BOOL SortCallback(const DirEntry &f1, const DirEntry &f2) {
@@ -195,16 +282,6 @@ void DirList::SortList(BOOL (*SortFunc)(const DirEntry &a, const DirEntry &b)) {
         std::sort(FileInfo.begin(), FileInfo.end(), SortFunc);
 }
 
-uint64_t DirList::GetFilesize(int32_t index) const {
-    struct stat st;
-    const char *path = GetFilepath(index);
-
-    if (!path || stat(path, &st) != 0)
-        return 0;
-
-    return st.st_size;
-}
-
 int32_t DirList::GetFileIndex(const char *filename) const {
     if (!filename)
         return -1;
@@ -27,12 +27,19 @@
 #ifndef ___DIRLIST_H_
 #define ___DIRLIST_H_
 
+#include <coreinit/filesystem_fsa.h>
 #include <string>
 #include <vector>
 #include <wut_types.h>
 
 typedef struct {
-    char *FilePath;
+    //! Points into the path arena of the owning DirList, only valid while the list is unchanged.
+    const char *FilePath;
+    uint32_t PathOffset;
+    //! Offset of the filename relative to FilePath
+    uint32_t NameOffset;
+    uint32_t FileSize;
+    int64_t ModifiedTime;
     BOOL isDir;
 } DirEntry;
 
@@ -67,7 +74,19 @@ public:
 
     //! Get the a filesize of the list
     //!\param list index
-    uint64_t GetFilesize(int32_t index) const;
+    uint64_t GetFilesize(int32_t index) const {
+        if (!valid(index))
+            return 0;
+        return FileInfo[index].FileSize;
+    }
+
+    //! Get the modification time (seconds since 1970) of an entry of the list
+    //!\param list index
+    int64_t GetModifiedTime(int32_t index) const {
+        if (!valid(index))
+            return 0;
+        return FileInfo[index].ModifiedTime;
+    }
 
     //! Is index a dir or a file
     //!\param list index
@@ -102,8 +121,17 @@ protected:
     // Internal parser
     BOOL InternalLoadPath(std::string &path);
 
+    //! Fallback for devoptab devices FSA doesn't know about, slower because every entry needs a stat
+    BOOL InternalLoadPathDevoptab(std::string &path);
+
+    //! Filters an entry of folderpath and adds it to the list, recurses into subfolders if requested
+    void ProcessEntry(std::string &folderpath, const char *filename, BOOL isDir, uint32_t fileSize, int64_t modifiedTime);
+
     //!Add a list entrie
-    void AddEntrie(const std::string &filepath, const char *filename, BOOL isDir);
+    void AddEntrie(const std::string &filepath, const char *filename, BOOL isDir, uint32_t fileSize, int64_t modifiedTime);
+
+    //! Resolve the FilePath pointers into the path arena once it won't grow anymore
+    void FinalizeEntries();
 
     //! Clear the list
     void ClearList();
@@ -116,7 +144,10 @@ protected:
     uint32_t Flags;
     uint32_t Depth;
     const char *Filter;
+    FSAClientHandle Client;
     std::vector<DirEntry> FileInfo;
+    //! All paths of the list, null terminated and stored back to back
+    std::vector<char> PathArena;
 };
 
 #endif
@@ -0,0 +1,235 @@
+#include "EnvironmentManifest.h"
+#include "fs/BinaryFile.h"
+#include "fs/DirList.h"
+#include "utils/logger.h"
+#include <sys/stat.h>
+
+#define MANIFEST_MAGIC   0x454C4D46 // "ELMF"
+#define MANIFEST_VERSION 4
+
+namespace {
+    struct ManifestHeader {
+        uint32_t magic;
+        uint32_t version;
+        int64_t rootMTime;
+        uint32_t environmentCount;
+        uint32_t moduleCount;
+        uint32_t stringTableSize;
+        uint32_t reserved;
+    };
+
+    struct ManifestEnvironmentEntry {
+        int64_t setupDirMTime;
+        uint32_t nameOffset;
+        uint32_t firstModule;
+        uint32_t moduleCount;
+        uint32_t reserved;
+    };
+
+    struct ManifestModuleEntry {
+        uint32_t nameOffset;
+        uint32_t size;
+        int64_t mtime;
+    };
+
+    enum ManifestSection {
+        SECTION_ENVIRONMENTS,
+        SECTION_MODULES,
+        SECTION_COUNT,
+    };
+} // namespace
+
+EnvironmentManifest::EnvironmentManifest(std::string_view rootPath, std::string_view manifestPath) : mRootPath(rootPath), mManifestPath(manifestPath) {
+    if (!mRootPath.ends_with('/')) {
+        mRootPath += '/';
+    }
+}
+
+std::optional<int64_t> EnvironmentManifest::GetMTime(const std::string &path) {
+    struct stat st {};
+    if (stat(path.c_str(), &st) != 0) {
+        return {};
+    }
+    return (int64_t) st.st_mtime;
+}
+
+bool EnvironmentManifest::Load() {
+    mEnvironments.clear();
+    mRootMTime = 0;
+    mChanged   = false;
+
+    BinaryFileReader reader("Environment manifest");
+    ManifestHeader header;
+    if (!reader.Load(mManifestPath, MANIFEST_MAGIC, MANIFEST_VERSION, header) ||
+        !reader.SetLayout({{header.environmentCount, sizeof(ManifestEnvironmentEntry)}, {header.moduleCount, sizeof(ManifestModuleEntry)}}, header.stringTableSize)) {
+        return false;
+    }
+
+    std::vector<ManifestEnvironment> environments;
+    environments.reserve(header.environmentCount);
+    for (uint32_t i = 0; i < header.environmentCount; i++) {
+        auto envEntry = reader.GetEntry<ManifestEnvironmentEntry>(SECTION_ENVIRONMENTS, i);
+        auto *envName = reader.GetString(envEntry.nameOffset);
+        if (!envName || envEntry.firstModule > header.moduleCount || envEntry.moduleCount > header.moduleCount - envEntry.firstModule) {
+            DEBUG_FUNCTION_LINE_WARN("Environment manifest has an invalid environment entry");
+            return false;
+        }
+
+        ManifestEnvironment env;
+        env.name          = envName;
+        env.setupDirMTime = envEntry.setupDirMTime;
+        env.setupModules.reserve(envEntry.moduleCount);
+        for (uint32_t j = envEntry.firstModule; j < envEntry.firstModule + envEntry.moduleCount; j++) {
+            auto moduleEntry = reader.GetEntry<ManifestModuleEntry>(SECTION_MODULES, j);
+            auto *moduleName = reader.GetString(moduleEntry.nameOffset);
+            if (!moduleName) {
+                DEBUG_FUNCTION_LINE_WARN("Environment manifest has an invalid module entry");
+                return false;
+            }
+            env.setupModules.push_back({moduleName, moduleEntry.size, moduleEntry.mtime});
+        }
+        environments.push_back(std::move(env));
+    }
+
+    mEnvironments = std::move(environments);
+    mRootMTime    = header.rootMTime;
+    DEBUG_FUNCTION_LINE_VERBOSE("Loaded environment manifest with %d environments and %d modules", header.environmentCount, header.moduleCount);
+    return true;
+}
+
+bool EnvironmentManifest::SaveIfChanged() {
+    if (!mChanged) {
+        return true;
+    }
+
+    BinaryFileWriter writer("Environment manifest", SECTION_COUNT);
+    uint32_t moduleCount = 0;
+
+    for (auto const &env : mEnvironments) {
+        ManifestEnvironmentEntry envEntry = {};
+        envEntry.nameOffset               = writer.AddString(env.name);
+        envEntry.firstModule              = moduleCount;
+        envEntry.moduleCount              = env.setupModules.size();
+        envEntry.setupDirMTime            = env.setupDirMTime;
+        writer.AppendEntry(SECTION_ENVIRONMENTS, envEntry);
+
+        for (auto const &module : env.setupModules) {
+            ManifestModuleEntry moduleEntry = {};
+            moduleEntry.nameOffset          = writer.AddString(module.name);
+            moduleEntry.size                = module.size;
+            moduleEntry.mtime               = module.mtime;
+            writer.AppendEntry(SECTION_MODULES, moduleEntry);
+        }
+        moduleCount += env.setupModules.size();
+    }
+
+    ManifestHeader header   = {};
+    header.magic            = MANIFEST_MAGIC;
+    header.version          = MANIFEST_VERSION;
+    header.rootMTime        = mRootMTime;
+    header.environmentCount = mEnvironments.size();
+    header.moduleCount      = moduleCount;
+    header.stringTableSize  = writer.GetStringTableSize();
+    if (!writer.Save(mManifestPath, header)) {
+        return false;
+    }
+
+    mChanged = false;
+    return true;
+}
+
+const std::vector<ManifestEnvironment> &EnvironmentManifest::GetEnvironments(bool forceRescan) {
+    auto rootMTime = GetMTime(mRootPath);
+    if (!forceRescan && rootMTime && *rootMTime == mRootMTime && mRootMTime != 0) {
+        return mEnvironments;
+    }
+
+    DEBUG_FUNCTION_LINE_VERBOSE("Scan environments in %s", mRootPath.c_str());
+    DirList environmentDirs(mRootPath, nullptr, DirList::Dirs, 1);
+
+    bool changed = (uint32_t) environmentDirs.GetFilecount() != mEnvironments.size();
+    std::vector<ManifestEnvironment> environments;
+    environments.reserve(environmentDirs.GetFilecount());
+    for (int i = 0; i < environmentDirs.GetFilecount(); i++) {
+        ManifestEnvironment env;
+        env.name = environmentDirs.GetFilename(i);
+        // Keep the cached setup modules of environments we already know, they are validated separately.
+        bool known = false;
+        for (auto &cur : mEnvironments) {
+            if (cur.name == env.name) {
+                env   = std::move(cur);
+                known = true;
+                break;
+            }
+        }
+        changed = changed || !known;
+        environments.push_back(std::move(env));
+    }
+
+    mEnvironments = std::move(environments);
+    if (changed || mRootMTime != rootMTime.value_or(0)) {
+        mRootMTime = rootMTime.value_or(0);
+        mChanged   = true;
+    }
+    return mEnvironments;
+}
+
+std::vector<ManifestModule> EnvironmentManifest::ScanSetupModules(const std::string &environmentPath) {
+    std::vector<ManifestModule> result;
+
+    DirList setupModules(environmentPath + "/modules/setup", ".rpx", DirList::Files, 1);
+    setupModules.SortList();
+
+    result.reserve(setupModules.GetFilecount());
+    for (int i = 0; i < setupModules.GetFilecount(); i++) {
+        //! skip hidden linux and mac files
+        if (setupModules.GetFilename(i)[0] == '.' || setupModules.GetFilename(i)[0] == '_') {
+            DEBUG_FUNCTION_LINE_ERR("Skip file %s", setupModules.GetFilepath(i));
+            continue;
+        }
+
+        result.push_back({setupModules.GetFilename(i), (uint32_t) setupModules.GetFilesize(i), setupModules.GetModifiedTime(i)});
+    }
+    return result;
+}
+
+std::vector<ManifestModule> EnvironmentManifest::GetSetupModules(const std::string &environmentPath, bool forceRescan) {
+    if (!environmentPath.starts_with(mRootPath)) {
+        return ScanSetupModules(environmentPath);
+    }
+
+    std::string_view name = std::string_view(environmentPath).substr(mRootPath.size());
+    if (name.ends_with('/')) {
+        name.remove_suffix(1);
+    }
+    if (name.empty() || name.find('/') != std::string_view::npos) {
+        return ScanSetupModules(environmentPath);
+    }
+
+    ManifestEnvironment *env = nullptr;
+    for (auto &cur : mEnvironments) {
+        if (cur.name == name) {
+            env = &cur;
+            break;
+        }
+    }
+    if (!env) {
+        mEnvironments.push_back({std::string(name), 0, {}});
+        env = &mEnvironments.back();
+    }
+
+    auto setupDirMTime = GetMTime(environmentPath + "/modules/setup");
+    if (!forceRescan && setupDirMTime && *setupDirMTime == env->setupDirMTime && env->setupDirMTime != 0) {
+        DEBUG_FUNCTION_LINE_VERBOSE("Use cached setup modules of %s", env->name.c_str());
+        return env->setupModules;
+    }
+
+    auto setupModules = ScanSetupModules(environmentPath);
+    if (env->setupModules != setupModules || env->setupDirMTime != setupDirMTime.value_or(0)) {
+        DEBUG_FUNCTION_LINE_VERBOSE("Setup modules of %s have changed", env->name.c_str());
+        env->setupModules  = setupModules;
+        env->setupDirMTime = setupDirMTime.value_or(0);
+        mChanged           = true;
+    }
+    return setupModules;
+}
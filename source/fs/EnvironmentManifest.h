@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ManifestModule {
+    std::string name;
+    uint32_t size = 0;
+    int64_t mtime = 0;
+
+    bool operator==(const ManifestModule &) const = default;
+};
+
+struct ManifestEnvironment {
+    std::string name;
+    // 0 means the setup modules of this environment have not been scanned yet.
+    int64_t setupDirMTime = 0;
+    std::vector<ManifestModule> setupModules;
+};
+
+/**
+ * Caches the list of environments and their ordered setup modules in a single file in the environments root.
+ * Each cached list is used as long as the mtime of the directory it was created from is unchanged, otherwise the
+ * directory is enumerated again (once, via FSA) and the manifest written back.
+ * FAT doesn't always update directory timestamps (e.g. when files are copied by Windows), so callers rescan with
+ * forceRescan when a cached entry turns out to be missing.
+ */
+class EnvironmentManifest {
+public:
+    EnvironmentManifest(std::string_view rootPath, std::string_view manifestPath);
+
+    //! Reads the manifest with a single file read. Returns false if it's missing or invalid.
+    bool Load();
+
+    //! Writes the manifest back to the sd card if anything has changed since it was loaded.
+    bool SaveIfChanged();
+
+    //! Returns all environments, the root directory is only enumerated if its mtime has changed or forceRescan is set.
+    const std::vector<ManifestEnvironment> &GetEnvironments(bool forceRescan = false);
+
+    //! Returns the ordered setup modules of the environment at environmentPath. Hidden files are already filtered out.
+    //! The setup directory is only enumerated if its mtime has changed, forceRescan is set or the environment is not inside the root.
+    std::vector<ManifestModule> GetSetupModules(const std::string &environmentPath, bool forceRescan = false);
+
+    static std::optional<int64_t> GetMTime(const std::string &path);
+
+private:
+    static std::vector<ManifestModule> ScanSetupModules(const std::string &environmentPath);
+
+    std::string mRootPath;
+    std::string mManifestPath;
+    int64_t mRootMTime = 0;
+    std::vector<ManifestEnvironment> mEnvironments;
+    bool mChanged = false;
+};
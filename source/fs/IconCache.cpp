@@ -0,0 +1,202 @@
+#include "IconCache.h"
+#include "fs/BinaryFile.h"
+#include "fs/EnvironmentManifest.h"
+#include "utils/FileUtils.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <cstdlib>
+#include <cstring>
+
+#define ICON_CACHE_MAGIC   0x454C4943 // "ELIC"
+#define ICON_CACHE_VERSION 1
+#define ICON_PIXELS        (IconCache::ICON_SIZE * IconCache::ICON_SIZE)
+
+namespace {
+    struct IconCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t iconSize;
+        uint32_t iconCount;
+        uint32_t stringTableSize;
+    };
+
+    struct IconCacheEntry {
+        uint32_t nameOffset;
+        int64_t mtime;
+    };
+
+    enum IconCacheSection {
+        SECTION_ICONS,
+        SECTION_COUNT,
+    };
+} // namespace
+
+IconCache::~IconCache() {
+    Stop();
+}
+
+void IconCache::Start(const std::map<std::string, std::string> &environments) {
+    mSlots.clear();
+    mSlots.reserve(environments.size());
+    for (auto const &[name, path] : environments) {
+        mSlots.push_back({name, path, nullptr});
+    }
+    mReadyCount  = 0;
+    mCancel      = false;
+    mCacheLoaded = false;
+    mDone        = false;
+    mDecoded     = 0;
+
+    if (!mThread.Start([this]() { Process(); }, CoreThread::GetWorkerAffinity(0), "EnvironmentLoader Icons")) {
+        DEBUG_FUNCTION_LINE_VERBOSE("Load icons on the main core, one per frame");
+    }
+}
+
+void IconCache::LoadNext() {
+    if (mThread.IsStarted() || mCancel) {
+        return;
+    }
+    ProcessNext();
+}
+
+void IconCache::Stop() {
+    mCancel = true;
+    mThread.Join();
+}
+
+void IconCache::Process() {
+    while (!mCancel && ProcessNext()) {
+    }
+    if (!mDone) {
+        DEBUG_FUNCTION_LINE_VERBOSE("Stopped loading icons after %d of %d environments", GetReadyCount(), mSlots.size());
+    }
+}
+
+bool IconCache::ProcessNext() {
+    if (mDone) {
+        return false;
+    }
+    if (!mCacheLoaded) {
+        Load();
+        mCacheLoaded = true;
+        return true;
+    }
+
+    uint32_t i = GetReadyCount();
+    if (i < mSlots.size()) {
+        auto &slot     = mSlots[i];
+        auto iconMTime = EnvironmentManifest::GetMTime(slot.path + "/icon.png");
+        auto cached    = mCached.find(slot.name);
+        if (!iconMTime) {
+            if (cached != mCached.end()) {
+                mCached.erase(cached);
+                mChanged = true;
+            }
+        } else if (cached != mCached.end() && cached->second.mtime == *iconMTime) {
+            slot.icon = cached->second.icon.get();
+        } else {
+            uint8_t *buffer = nullptr;
+            uint32_t size   = 0;
+            if (LoadFileToMem((slot.path + "/icon.png").c_str(), &buffer, &size) >= 0) {
+                auto icon = ImageSurface::LoadPNG(buffer, size, ICON_SIZE, ICON_SIZE);
+                free(buffer);
+                if (icon) {
+                    slot.icon          = icon->get();
+                    mCached[slot.name] = {*iconMTime, std::move(*icon)};
+                    mChanged           = true;
+                    mDecoded++;
+                } else {
+                    DEBUG_FUNCTION_LINE_WARN("Failed to decode %s/icon.png", slot.path.c_str());
+                }
+            }
+        }
+        mReadyCount.store(i + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Forget icons of environments that no longer exist
+    for (auto it = mCached.begin(); it != mCached.end();) {
+        bool found = false;
+        for (auto const &slot : mSlots) {
+            if (slot.name == it->first) {
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            ++it;
+        } else {
+            it       = mCached.erase(it);
+            mChanged = true;
+        }
+    }
+    DEBUG_FUNCTION_LINE_VERBOSE("Loaded icons of %d environments, %d had to be decoded", mSlots.size(), mDecoded);
+    mDone = true;
+    return false;
+}
+
+void IconCache::Load() {
+    mCached.clear();
+
+    BinaryFileReader reader("Icon cache");
+    IconCacheHeader header;
+    if (!reader.Load(mCachePath, ICON_CACHE_MAGIC, ICON_CACHE_VERSION, header)) {
+        return;
+    }
+    if (header.iconSize != ICON_SIZE) {
+        DEBUG_FUNCTION_LINE_WARN("Icon cache has an unexpected icon size");
+        return;
+    }
+    // The pixels of all icons follow the string table.
+    if (!reader.SetLayout({{header.iconCount, sizeof(IconCacheEntry)}}, header.stringTableSize, (uint64_t) header.iconCount * ICON_PIXELS * sizeof(uint32_t))) {
+        return;
+    }
+
+    auto *pixels = reader.GetTrailingData();
+    for (uint32_t i = 0; i < header.iconCount; i++) {
+        auto entry = reader.GetEntry<IconCacheEntry>(SECTION_ICONS, i);
+        auto *name = reader.GetString(entry.nameOffset);
+        if (!name) {
+            DEBUG_FUNCTION_LINE_WARN("Icon cache has an invalid entry");
+            mCached.clear();
+            return;
+        }
+        auto iconPixels = make_unique_nothrow<uint32_t[]>(ICON_PIXELS);
+        if (!iconPixels) {
+            DEBUG_FUNCTION_LINE_ERR("Failed to allocate icon");
+            return;
+        }
+        memcpy(iconPixels.get(), pixels + i * ICON_PIXELS * sizeof(uint32_t), ICON_PIXELS * sizeof(uint32_t));
+        auto icon = make_unique_nothrow<ImageSurface>(ICON_SIZE, ICON_SIZE, std::move(iconPixels));
+        if (!icon) {
+            DEBUG_FUNCTION_LINE_ERR("Failed to allocate icon");
+            return;
+        }
+        mCached[name] = {entry.mtime, std::move(icon)};
+    }
+}
+
+bool IconCache::SaveIfChanged() {
+    if (!mChanged) {
+        return true;
+    }
+
+    BinaryFileWriter writer("Icon cache", SECTION_COUNT);
+    for (auto const &[name, cached] : mCached) {
+        writer.AppendEntry(SECTION_ICONS, IconCacheEntry{writer.AddString(name), cached.mtime});
+        writer.AppendTrailingData(cached.icon->GetPixels(), ICON_PIXELS * sizeof(uint32_t));
+    }
+
+    IconCacheHeader header = {};
+    header.magic           = ICON_CACHE_MAGIC;
+    header.version         = ICON_CACHE_VERSION;
+    header.iconSize        = ICON_SIZE;
+    header.iconCount       = mCached.size();
+    header.stringTableSize = writer.GetStringTableSize();
+    if (!writer.Save(mCachePath, header)) {
+        return false;
+    }
+
+    mChanged = false;
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "utils/CoreThread.h"
+#include "utils/ImageSurface.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Loads the optional icon.png of each environment on a worker core. Without worker cores, the menu loads one icon per
+ * frame via LoadNext() instead, so the first frame never waits for a PNG to be decoded.
+ * Decoded icons are stored downscaled to ICON_SIZE x ICON_SIZE in a single cache file, keyed by the environment name
+ * and the mtime of its icon, so the PNG is only decoded again when it changes.
+ */
+class IconCache {
+public:
+    static constexpr uint32_t ICON_SIZE = 36;
+
+    explicit IconCache(std::string_view cachePath) : mCachePath(cachePath) {
+    }
+
+    ~IconCache();
+
+    IconCache(const IconCache &) = delete;
+    IconCache &operator=(const IconCache &) = delete;
+
+    //! Starts loading the icons of environments (name, path) in the background.
+    void Start(const std::map<std::string, std::string> &environments);
+
+    //! Loads the cache file or the next icon on the calling thread if there is no worker, call it once per frame
+    //! after the frame has been presented. Does nothing if the icons are loaded in the background.
+    void LoadNext();
+
+    //! Stops loading icons as soon as possible and waits for the worker.
+    void Stop();
+
+    //! The icons of the first n environments are ready. Only ever grows.
+    [[nodiscard]] uint32_t GetReadyCount() const {
+        return mReadyCount.load(std::memory_order_acquire);
+    }
+
+    //! Returns the icon of the environment at index, or nullptr if it has none or it isn't ready yet.
+    [[nodiscard]] const ImageSurface *GetIcon(uint32_t index) const {
+        return index < GetReadyCount() ? mSlots[index].icon : nullptr;
+    }
+
+    //! Writes the cache file if anything has changed. Must only be called after Stop().
+    bool SaveIfChanged();
+
+private:
+    struct CachedIcon {
+        int64_t mtime = 0;
+        std::unique_ptr<ImageSurface> icon;
+    };
+
+    struct Slot {
+        std::string name;
+        std::string path;
+        const ImageSurface *icon = nullptr;
+    };
+
+    void Load();
+
+    void Process();
+
+    //! Does the next step of loading: read the cache file, load one icon or forget stale icons once all are loaded.
+    //! Returns false if there is nothing left to do.
+    bool ProcessNext();
+
+    std::string mCachePath;
+    std::map<std::string, CachedIcon> mCached;
+    std::vector<Slot> mSlots;
+    std::atomic<uint32_t> mReadyCount = 0;
+    std::atomic<bool> mCancel         = false;
+    bool mChanged                     = false;
+    bool mCacheLoaded                 = false;
+    bool mDone                        = false;
+    uint32_t mDecoded                 = 0;
+    CoreThread mThread;
+};
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 
 #include "utils/StringTools.h"
@@ -29,11 +30,19 @@
 
 #include "ElfUtils.h"
 #include "common/module_defines.h"
-#include "fs/DirList.h"
+#include "fs/BootHistory.h"
+#include "fs/BootReport.h"
+#include "fs/EnvironmentManifest.h"
+#include "fs/IconCache.h"
 #include "kernel.h"
 #include "module/ModuleDataFactory.h"
+#include "utils/BootConfig.h"
+#include "utils/CoreThread.h"
+#include "utils/DamageTracker.h"
 #include "utils/DrawUtils.h"
+#include "utils/FilePrefetcher.h"
 #include "utils/FileUtils.h"
+#include "utils/FramePacer.h"
 #include "utils/InputUtils.h"
 #include "utils/OnLeavingScope.h"
 #include "utils/PairUtils.h"
@@ -44,7 +53,38 @@
 #define ENVIRONMENT_LOADER_VERSION "v0.3.2"
 
 #define MEMORY_REGION_START        0x00800000
-#define AUTOBOOT_CONFIG_PATH       "fs:/vol/external01/wiiu/environments/default.cfg"
+#define ENVIRONMENTS_ROOT_PATH     "fs:/vol/external01/wiiu/environments/"
+#define AUTOBOOT_CONFIG_PATH       ENVIRONMENTS_ROOT_PATH "default.cfg"
+#define ENVIRONMENT_MANIFEST_PATH  ENVIRONMENTS_ROOT_PATH "manifest.bin"
+#define ICON_CACHE_PATH            ENVIRONMENTS_ROOT_PATH "icons.bin"
+#define BOOT_REPORT_PATH           ENVIRONMENTS_ROOT_PATH "last_boot.csv"
+#define BOOT_HISTORY_PATH          ENVIRONMENTS_ROOT_PATH "boot_history.bin"
+
+// Held on the GamePad while booting, raise the log level of this boot.
+#define LOG_COMBO_VERBOSE          (VPAD_BUTTON_L | VPAD_BUTTON_R)
+#define LOG_COMBO_TRACE            (VPAD_BUTTON_L | VPAD_BUTTON_R | VPAD_BUTTON_ZL | VPAD_BUTTON_ZR)
+
+// The button combo wins over the boot config.
+uint32_t GetLogLevel(const BootConfig &config, uint32_t gamePadButtons) {
+    if ((gamePadButtons & LOG_COMBO_TRACE) == LOG_COMBO_TRACE) {
+        return LOG_LEVEL_TRACE;
+    }
+    if ((gamePadButtons & LOG_COMBO_VERBOSE) == LOG_COMBO_VERBOSE) {
+        return std::max<uint32_t>(config.logLevel, LOG_LEVEL_VERBOSE);
+    }
+    return config.logLevel;
+}
+
+// Worker threads stay disabled unless the boot config allows them, see CoreThread.
+void ApplyWorkerConfig(const BootConfig &config) {
+    CoreThread::SetWorkerCount(config.loaderThreads);
+    // The log buffer is set up before any config has been read.
+    if (config.loaderThreads > 0) {
+        startLogDrainThread();
+    } else {
+        stopLogDrainThread();
+    }
+}
 
 bool CheckRunning() {
     switch (ProcUIProcessMessages(true)) {
@@ -97,8 +137,12 @@ bool writeFileContent(const std::string &path, const std::string &content) {
 
 extern "C" void __fini();
 extern "C" void __init_wut_malloc();
-void LoadAndRunModule(std::string_view filepath, std::string_view environment_path);
+// Returns false if the module file couldn't be read, nothing has been run in that case.
+bool LoadAndRunModule(const std::string &filepath, const std::string &nextFilepath, std::string_view environment_path, const BootConfig &config, FilePrefetcher &prefetcher,
+                      CoreThread &displaySetupThread, ModuleBootMetrics &metrics);
+void MountSDCard();
 void ClearSavedFrameBuffers();
+void SetupDisplayForModules();
 
 int main(int argc, char **argv) {
     // We need to call __init_wut_malloc somewhere so wut_malloc will be used for the memory allocation.
@@ -109,9 +153,9 @@ int main(int argc, char **argv) {
         auto checkTiramisuHBL = fopen("fs:/vol/external01/wiiu/environments/tiramisu/modules/setup/50_hbl_installer.rpx", "r");
         if (checkTiramisuHBL != nullptr) {
             fclose(checkTiramisuHBL);
-            OSFatal("Don't run the EnvironmentLoader twice.\n\nIf you want to open the Homebrew Launcher, launch the Mii Maker\ninstead.");
+            FATAL_ERROR("Don't run the EnvironmentLoader twice.\n\nIf you want to open the Homebrew Launcher, launch the Mii Maker\ninstead.");
         } else {
-            OSFatal("Don't run the EnvironmentLoader twice.");
+            FATAL_ERROR("Don't run the EnvironmentLoader twice.");
         }
     }
 
@@ -131,80 +175,159 @@ int main(int argc, char **argv) {
     bool noEnvironmentsFound = false;
     bool shownMenu           = false;
 
-    std::string environmentPath = std::string(environmentPathFromIOSU);
-    if (!environmentPath.starts_with("fs:/vol/external01/wiiu/environments/")) { // If the environment path in IOSU is empty or unexpected, read config
-        DirList environmentDirs("fs:/vol/external01/wiiu/environments/", nullptr, DirList::Dirs, 1);
+    EnvironmentManifest manifest(ENVIRONMENTS_ROOT_PATH, ENVIRONMENT_MANIFEST_PATH);
+    manifest.Load();
 
-        std::map<std::string, std::string> environmentPaths;
-        for (int i = 0; i < environmentDirs.GetFilecount(); i++) {
-            environmentPaths[environmentDirs.GetFilename(i)] = environmentDirs.GetFilepath(i);
-        }
+    BootConfig bootConfig;
+    bool bootConfigLoaded   = false;
+    uint32_t gamePadButtons = 0;
 
-        bool forceMenu     = true;
-        auto res           = getFileContent(AUTOBOOT_CONFIG_PATH);
-        auto autobootIndex = -1;
+    std::string environmentPath = std::string(environmentPathFromIOSU);
+    if (!environmentPath.starts_with(ENVIRONMENTS_ROOT_PATH)) { // If the environment path in IOSU is empty or unexpected, read config
+        bool forceMenu = true;
+        auto res       = getFileContent(AUTOBOOT_CONFIG_PATH);
         if (res) {
             DEBUG_FUNCTION_LINE_VERBOSE("Got result %s", res->c_str());
-            int32_t i = 0;
-            for (auto const &[key, val] : environmentPaths) {
-                if (res.value() == key) {
-                    DEBUG_FUNCTION_LINE("Found environment %s from config at index %d", res.value().c_str(), i);
-                    autobootIndex   = i;
-                    environmentPath = val;
+            // Open the configured environment directly instead of enumerating all environments.
+            if (!res->empty() && res->find('/') == std::string::npos && *res != "." && *res != "..") {
+                std::string autobootPath = ENVIRONMENTS_ROOT_PATH + res.value();
+                if (EnvironmentManifest::GetMTime(autobootPath)) {
+                    DEBUG_FUNCTION_LINE("Found environment %s from config", res->c_str());
+                    environmentPath = autobootPath;
                     forceMenu       = false;
-                    break;
                 }
-                i++;
             }
         } else {
             DEBUG_FUNCTION_LINE_ERR("No config found");
         }
 
-        InputUtils::Init();
-
-        InputUtils::InputData input = InputUtils::getControllerInput();
+        bool openMenu = forceMenu;
+        if (!openMenu) {
+            // The config of the default environment decides how long and on which controllers we check for X.
+            bootConfig       = BootConfig::Load(environmentPath);
+            bootConfigLoaded = true;
+            openMenu         = InputUtils::isHeldWithin(VPAD_BUTTON_X, bootConfig.bootKeyWindowMs, bootConfig.bootKeyKPAD, &gamePadButtons);
+            setLogLevel(GetLogLevel(bootConfig, gamePadButtons));
+            // The menu uses the worker cores of the default environment.
+            ApplyWorkerConfig(bootConfig);
+        }
 
-        if (forceMenu || ((input.trigger | input.hold) & VPAD_BUTTON_X) == VPAD_BUTTON_X) {
+        if (openMenu) {
             shownMenu = true;
             DEBUG_FUNCTION_LINE_VERBOSE("Open menu!");
+            std::map<std::string, std::string> environmentPaths;
+            // Opening the menu is the way to pick up changes the directory mtime doesn't show.
+            for (auto const &env : manifest.GetEnvironments(true)) {
+                environmentPaths[env.name] = ENVIRONMENTS_ROOT_PATH + env.name;
+            }
+            int32_t autobootIndex = -1;
+            if (res) {
+                auto it = environmentPaths.find(res.value());
+                if (it != environmentPaths.end()) {
+                    autobootIndex = (int32_t) std::distance(environmentPaths.begin(), it);
+                    DEBUG_FUNCTION_LINE("Found environment %s from config at index %d", res->c_str(), autobootIndex);
+                }
+            }
+
+            InputUtils::Init();
             environmentPath = EnvironmentSelectionScreen(environmentPaths, autobootIndex);
+            InputUtils::DeInit();
+
             if (environmentPaths.empty()) {
                 noEnvironmentsFound = true;
             } else {
                 DEBUG_FUNCTION_LINE_VERBOSE("Selected %s", environmentPath.c_str());
             }
-        } else {
         }
-        InputUtils::DeInit();
     }
 
-    if (!shownMenu) {
-        // Clear saved frame buffer to reduce screen corruption
-        ClearSavedFrameBuffers();
-
-        OSScreenInit();
+    if (noEnvironmentsFound) {
+        bootConfig = {};
+    } else if (!bootConfigLoaded || shownMenu) {
+        bootConfig = BootConfig::Load(environmentPath);
+    }
+    setLogLevel(GetLogLevel(bootConfig, gamePadButtons));
+    gTraceLogging = bootConfig.trace || gLogLevel >= LOG_LEVEL_TRACE;
+    ApplyWorkerConfig(bootConfig);
 
-        // Call GX2Init to shut down OSScreen
-        GX2Init(nullptr);
+    // Joined before the first entrypoint is called at the latest.
+    CoreThread displaySetupThread;
+    if (!shownMenu) {
+        auto displaySetupMode = bootConfig.displaySetup;
+        if (displaySetupMode == BootConfig::DISPLAY_SETUP_ASYNC && bootConfig.loaderThreads == 0) {
+            displaySetupMode = BootConfig::DISPLAY_SETUP_SYNC;
+        }
 
-        GX2SetTVEnable(FALSE);
-        GX2SetDRCEnable(FALSE);
+        switch (displaySetupMode) {
+            case BootConfig::DISPLAY_SETUP_SYNC: {
+                SetupDisplayForModules();
+                break;
+            }
+            case BootConfig::DISPLAY_SETUP_ASYNC: {
+                // Use a different core than the prefetching if we are allowed to.
+                auto affinity = CoreThread::GetWorkerAffinity(bootConfig.loaderThreads > 1 ? 1 : 0);
+                if (!displaySetupThread.Start(SetupDisplayForModules, affinity, "EnvironmentLoader DisplaySetup")) {
+                    SetupDisplayForModules();
+                }
+                break;
+            }
+            case BootConfig::DISPLAY_SETUP_SKIP: {
+                DEBUG_FUNCTION_LINE_TRACE("Skip display setup");
+                break;
+            }
+        }
     }
 
     RevertMainHook();
 
     if (!noEnvironmentsFound) {
-        DirList setupModules(environmentPath + "/modules/setup", ".rpx", DirList::Files, 1);
-        setupModules.SortList();
-
-        for (int i = 0; i < setupModules.GetFilecount(); i++) {
-            //! skip hidden linux and mac files
-            if (setupModules.GetFilename(i)[0] == '.' || setupModules.GetFilename(i)[0] == '_') {
-                DEBUG_FUNCTION_LINE_ERR("Skip file %s", setupModules.GetFilepath(i));
+        auto setupModules = manifest.GetSetupModules(environmentPath);
+        // Setup modules may unmount the sd card, make sure to update the manifest before running them.
+        manifest.SaveIfChanged();
+
+        FilePrefetcher prefetcher(bootConfig.prefetch && bootConfig.loaderThreads > 0);
+        BootReport report(environmentPath.substr(environmentPath.rfind('/') + 1));
+        bool rescanned = false;
+        uint32_t i     = 0;
+        while (i < setupModules.size()) {
+            std::string modulePath     = environmentPath + "/modules/setup/" + setupModules[i].name;
+            std::string nextModulePath = i + 1 < setupModules.size() ? environmentPath + "/modules/setup/" + setupModules[i + 1].name : "";
+            ModuleBootMetrics metrics;
+            metrics.name = setupModules[i].name;
+            if (!LoadAndRunModule(modulePath, nextModulePath, environmentPath, bootConfig, prefetcher, displaySetupThread, metrics)) {
+                if (rescanned) {
+                    FATAL_ERROR("EnvironmentLoader: Failed to load file to memory");
+                }
+                // The directory mtime isn't always updated on FAT, the manifest may still list a module that has been removed.
+                DEBUG_FUNCTION_LINE_WARN("Failed to load %s, scan the setup modules again", modulePath.c_str());
+                rescanned       = true;
+                auto lastModule = i > 0 ? setupModules[i - 1].name : std::string();
+                setupModules    = manifest.GetSetupModules(environmentPath, true);
+                manifest.SaveIfChanged();
+                // Continue after the last module that has been run, the list is sorted like DirList::SortList does.
+                i = 0;
+                while (!lastModule.empty() && i < setupModules.size() && strcasecmp(setupModules[i].name.c_str(), lastModule.c_str()) <= 0) {
+                    i++;
+                }
                 continue;
             }
+            report.AddModule(std::move(metrics));
+            i++;
+        }
 
-            LoadAndRunModule(setupModules.GetFilepath(i), environmentPath);
+        // Write the report before handing off to the system, the last setup module may have unmounted the sd card.
+        if (bootConfig.bootReport || bootConfig.bootHistory > 0) {
+            MountSDCard();
+        }
+        if (bootConfig.bootHistory > 0) {
+            BootHistory history(BOOT_HISTORY_PATH);
+            history.Load();
+            history.FlagRegressions(report, bootConfig.regressionThreshold);
+            history.Add(report, bootConfig.bootHistory);
+            history.Save();
+        }
+        if (bootConfig.bootReport) {
+            report.Save(BOOT_REPORT_PATH);
         }
 
     } else {
@@ -287,7 +410,8 @@ std::optional<HeapWrapper> GetHeapForModule(uint32_t heapSize) {
         return heapWrapper;
     }
 
-    // If Aroma is not already loaded, we use the existing 0x00800000 - 0x01000000 memory region. This is where aroma is loaded to. Note: this region may be only mapped to the main core.
+    // If Aroma is not already loaded, we use the existing 0x00800000 - 0x01000000 memory region. This is where aroma is loaded to. Note: this region may be only mapped to the main core,
+    // which is why worker threads are disabled unless the boot config allows them (see CoreThread).
     // The environment loader is loaded to the end of 0x00800000 - 0x01000000 memory region. With this helper we know the start of the .text section
     uint32_t textSectionStart = textStart() - 0x100;
 
@@ -303,7 +427,7 @@ std::optional<HeapWrapper> GetHeapForModule(uint32_t heapSize) {
     DEBUG_FUNCTION_LINE("Let's create a memory wrapper for 0x%08X, size: %d", startAddress, size);
     auto res = HeapWrapper(MemoryWrapper((void *) startAddress, size, /* we don't need to free this memory*/ nullptr));
     if ((uint32_t) res.GetHeapHandle() != startAddress) {
-        OSFatal("EnvironmentLoader: Unexpected address");
+        FATAL_ERROR("EnvironmentLoader: Unexpected address");
     }
     return res;
 }
@@ -319,7 +443,7 @@ void SetupKernelModule() {
 
     if (OSDynLoad_FindExport(module, OS_DYNLOAD_EXPORT_FUNC, "KernelSetupDefaultSyscalls", reinterpret_cast<void **>(&KernelSetupDefaultSyscalls)) != OS_DYNLOAD_OK) {
         DEBUG_FUNCTION_LINE("OSDynLoad_FindExport for KernelSetupDefaultSyscalls failed");
-        OSFatal("EnvironmentLoader: KernelModule is missing the export\n"
+        FATAL_ERROR("EnvironmentLoader: KernelModule is missing the export\n"
                 "\"KernelSetupDefaultSyscalls\"... Please update Aroma!\n"
                 "\n"
                 "See https://wiiu.hacks.guide/ for more information.");
@@ -328,7 +452,7 @@ void SetupKernelModule() {
 
     if (!KernelSetupDefaultSyscalls) {
         DEBUG_FUNCTION_LINE_WARN("KernelSetupDefaultSyscalls is null");
-        OSFatal("EnvironmentLoader: KernelModule is missing the export\n"
+        FATAL_ERROR("EnvironmentLoader: KernelModule is missing the export\n"
                 "\"KernelSetupDefaultSyscalls\"... Please update Aroma!\n"
                 "\n"
                 "See https://wiiu.hacks.guide/ for more information.");
@@ -340,8 +464,7 @@ void SetupKernelModule() {
     OSDynLoad_Release(module);
 }
 
-void LoadAndRunModule(std::string_view filepath, std::string_view environment_path) {
-    // Some module may unmount the sd card on exit.
+void MountSDCard() {
     FSAInit();
     auto client = FSAAddClient(nullptr);
     if (client) {
@@ -350,30 +473,45 @@ void LoadAndRunModule(std::string_view filepath, std::string_view environment_pa
     } else {
         DEBUG_FUNCTION_LINE_ERR("Failed to add FSA client");
     }
+}
 
-    DEBUG_FUNCTION_LINE("Trying to load %s into memory", filepath.data());
-    uint8_t *buffer = nullptr;
-    uint32_t fsize  = 0;
-    if (LoadFileToMem(filepath.data(), &buffer, &fsize) < 0) {
+bool LoadAndRunModule(const std::string &filepath, const std::string &nextFilepath, std::string_view environment_path, const BootConfig &config, FilePrefetcher &prefetcher,
+                      CoreThread &displaySetupThread, ModuleBootMetrics &metrics) {
+    // Some module may unmount the sd card on exit.
+    MountSDCard();
+
+    DEBUG_FUNCTION_LINE("Trying to load %s into memory", filepath.c_str());
+    OSTime takeStart = OSGetTime();
+    uint8_t *buffer  = nullptr;
+    uint32_t fsize   = 0;
+    if (prefetcher.Take(filepath, &buffer, &fsize, &metrics.readTicks, &metrics.prefetched) < 0) {
         DEBUG_FUNCTION_LINE_ERR("Failed to load file");
-        OSFatal("EnvironmentLoader: Failed to load file to memory");
-        return;
+        return false;
     }
 
     auto cleanupBuffer = onLeavingScope([buffer]() { free(buffer); });
 
-    ELFIO::elfio reader(new wiiu_zlib);
+    // Read the next module while this one is parsed and linked. The read has to be finished before calling the entrypoint.
+    if (!nextFilepath.empty()) {
+        prefetcher.Start(nextFilepath);
+    }
+
+    OSTime parseStart = OSGetTime();
+    metrics.fileSize  = fsize;
+    // A prefetched file was read on another core, everything spent in Take() was waiting for it.
+    metrics.waitTicks = parseStart - takeStart - (metrics.prefetched ? 0 : metrics.readTicks);
+    ELFIO::elfio reader(new wiiu_zlib(&metrics.inflate));
     // Load ELF data
     if (!reader.load(reinterpret_cast<const char *>(buffer), fsize)) {
         DEBUG_FUNCTION_LINE_ERR("Can't parse .wms from buffer.");
-        OSFatal("Can't parse .wms from buffer.");
-        return;
+        FATAL_ERROR("Can't parse .wms from buffer.");
+        return false;
     }
 
     uint32_t moduleSize = ModuleDataFactory::GetSizeOfModule(reader);
     DEBUG_FUNCTION_LINE_VERBOSE("Module has size: %d", moduleSize);
 
-    uint32_t requiredHeapSize = moduleSize + sizeof(module_information_t) + 0x10000; // add another 0x10000 to be safe
+    uint32_t requiredHeapSize = moduleSize + sizeof(module_information_t) + config.heapMargin; // add some extra memory to be safe
     DEBUG_FUNCTION_LINE_VERBOSE("Allocate %d bytes for heap (%.2f KiB)", requiredHeapSize, requiredHeapSize / 1024.0f);
 
     if (auto heapWrapperOpt = GetHeapForModule(requiredHeapSize); heapWrapperOpt.has_value()) {
@@ -381,8 +519,8 @@ void LoadAndRunModule(std::string_view filepath, std::string_view environment_pa
         auto moduleInfoOpt = heapWrapperOpt->Alloc(sizeof(module_information_t), 0x4);
         if (!moduleInfoOpt) {
             DEBUG_FUNCTION_LINE_ERR("Failed to alloc module information");
-            OSFatal("EnvironmentLoader: Failed to alloc module information");
-            return;
+            FATAL_ERROR("EnvironmentLoader: Failed to alloc module information");
+            return false;
         }
 
         auto moduleInfo    = std::move(*moduleInfoOpt);
@@ -390,18 +528,25 @@ void LoadAndRunModule(std::string_view filepath, std::string_view environment_pa
         *moduleInfoPtr     = {};
 
         // Frees automatically, must not survive the heapWrapper.
-        auto moduleData = ModuleDataFactory::load(reader, *heapWrapperOpt, moduleInfoPtr->trampolines, sizeof(moduleInfoPtr->trampolines) / sizeof(moduleInfoPtr->trampolines[0]));
+        OSTime linkStart = OSGetTime();
+        auto moduleData  = ModuleDataFactory::load(reader, *heapWrapperOpt, moduleInfoPtr->trampolines, sizeof(moduleInfoPtr->trampolines) / sizeof(moduleInfoPtr->trampolines[0]),
+                                                   &metrics.relocations);
         if (!moduleData) {
-            DEBUG_FUNCTION_LINE_ERR("Failed to load %s", filepath);
-            OSFatal("EnvironmentLoader: Failed to load module");
-            return;
+            DEBUG_FUNCTION_LINE_ERR("Failed to load %s", filepath.c_str());
+            FATAL_ERROR("EnvironmentLoader: Failed to load module");
+            return false;
         }
 
         DEBUG_FUNCTION_LINE("Loaded module data");
+        metrics.imports        = moduleData.value()->getRelocationDataList().size();
+        metrics.heapRequested  = requiredHeapSize;
+        metrics.heapPeakUsed   = heapWrapperOpt->GetUsedSize();
+        OSTime relocationStart = OSGetTime();
         std::map<std::string, OSDynLoad_Module> usedRPls;
-        if (!ElfUtils::doRelocation(moduleData.value()->getRelocationDataList(), moduleInfoPtr->trampolines, sizeof(moduleInfoPtr->trampolines) / sizeof(moduleInfoPtr->trampolines[0]), usedRPls)) {
+        if (!ElfUtils::doRelocation(moduleData.value()->getRelocationDataList(), moduleInfoPtr->trampolines, sizeof(moduleInfoPtr->trampolines) / sizeof(moduleInfoPtr->trampolines[0]), usedRPls,
+                                    &metrics.relocations)) {
             DEBUG_FUNCTION_LINE_ERR("Relocations failed");
-            OSFatal("EnvironmentLoader: Relocations failed");
+            FATAL_ERROR("EnvironmentLoader: Relocations failed");
         } else {
             DEBUG_FUNCTION_LINE("Relocation done");
         }
@@ -422,12 +567,37 @@ void LoadAndRunModule(std::string_view filepath, std::string_view environment_pa
         }
         arr[3] = (char *) usable_mem_end; // End of usable memory
 
+        // The module may unmount the sd card or change the memory layout, make sure the next module has been read completely.
+        // Its buffer stays allocated (on the default heap, outside the module heaps) until the next iteration takes it,
+        // so while this entrypoint runs up to two module files are in memory.
+        OSTime backgroundWaitStart = OSGetTime();
+        prefetcher.Wait();
+        // Don't let the module see a display that is still being set up.
+        displaySetupThread.Join();
+
         DEBUG_FUNCTION_LINE("Calling entrypoint @%08X with: \"%s\", \"%s\", %08X, %08X", moduleData.value()->getEntrypoint(), arr[0], arr[1], arr[2], arr[3]);
+        // The module may replace the log handlers, change the memory mapping or never return. Write out what we have so far
+        // and don't let the drain thread run loader code on another core while the module is running.
+        stopLogDrainThread();
+        OSTime entrypointStart = OSGetTime();
         // clang-format off
         ((int(*)(int, char **)) moduleData.value()->getEntrypoint())(sizeof(arr)/ sizeof(arr[0]), arr);
         // clang-format on
+        OSTime entrypointEnd = OSGetTime();
+        startLogDrainThread();
         DEBUG_FUNCTION_LINE("Back from module");
 
+        metrics.parseTicks      = linkStart - parseStart - metrics.inflate.ticks;
+        metrics.linkTicks       = relocationStart - linkStart;
+        metrics.importTicks     = backgroundWaitStart - relocationStart;
+        metrics.entrypointTicks = entrypointEnd - entrypointStart;
+        metrics.waitTicks += entrypointStart - backgroundWaitStart;
+
+        DEBUG_FUNCTION_LINE_TRACE("%s: read %lld us, parse %lld us, inflate %lld us, link %lld us, relocation %lld us, background wait %lld us, entrypoint %lld us", filepath.c_str(),
+                                  OSTicksToMicroseconds(metrics.readTicks), OSTicksToMicroseconds(metrics.parseTicks), OSTicksToMicroseconds(metrics.inflate.ticks),
+                                  OSTicksToMicroseconds(metrics.linkTicks), OSTicksToMicroseconds(metrics.importTicks), OSTicksToMicroseconds(metrics.waitTicks),
+                                  OSTicksToMicroseconds(metrics.entrypointTicks));
+
         for (auto &rpl : usedRPls) {
             DEBUG_FUNCTION_LINE_VERBOSE("Release %s", rpl.first.c_str());
             OSDynLoad_Release(rpl.second);
@@ -435,11 +605,12 @@ void LoadAndRunModule(std::string_view filepath, std::string_view environment_pa
 
     } else {
         DEBUG_FUNCTION_LINE_ERR("Failed to create heap");
-        OSFatal("EnvironmentLoader: Failed to create heap");
+        FATAL_ERROR("EnvironmentLoader: Failed to create heap");
     }
 
     // module may override the syscalls used by the Aroma KernelModule. This (tries to) re-init(s) the KernelModule after a setup module has been run.
     SetupKernelModule();
+    return true;
 }
 
 void ClearSavedFrameBuffers() {
@@ -456,6 +627,23 @@ void ClearSavedFrameBuffers() {
     __OSClearSavedFrame(OS_SAVED_FRAME_B, OS_SAVED_FRAME_SCREEN_DRC);
 }
 
+void SetupDisplayForModules() {
+    OSTime start = OSGetTime();
+
+    // Clear saved frame buffer to reduce screen corruption
+    ClearSavedFrameBuffers();
+
+    OSScreenInit();
+
+    // Call GX2Init to shut down OSScreen
+    GX2Init(nullptr);
+
+    GX2SetTVEnable(FALSE);
+    GX2SetDRCEnable(FALSE);
+
+    DEBUG_FUNCTION_LINE_TRACE("Display setup on core %d took %lld us", OSGetCoreId(), OSTicksToMicroseconds(OSGetTime() - start));
+}
+
 void AbortQuickStartMenu() {
     CCRCDCDrcState state = {};
     CCRCDCSysGetDrcState(CCR_CDC_DESTINATION_DRC0, &state);
@@ -465,10 +653,143 @@ void AbortQuickStartMenu() {
     }
 }
 
+// Layout of the environment list between the top and the bottom bar
+#define LIST_TOP          (8 + 24 + 8 + 4)
+#define LIST_BOTTOM       (SCREEN_HEIGHT - 24 - 8 - 4 - 4)
+#define LIST_ROW_HEIGHT   (42 + 8)
+#define LIST_ENTRY_HEIGHT 44
+#define LIST_VISIBLE_ROWS ((LIST_BOTTOM - LIST_TOP + LIST_ROW_HEIGHT - LIST_ENTRY_HEIGHT) / LIST_ROW_HEIGHT)
+
+Rect GetEnvironmentListRect() {
+    return {0, LIST_TOP, SCREEN_WIDTH, LIST_BOTTOM - LIST_TOP};
+}
+
+// Returns an empty rect if the entry is scrolled out of view
+Rect GetEnvironmentEntryRect(int32_t index, uint32_t scrollOffset) {
+    int32_t row = index - (int32_t) scrollOffset;
+    if (index < 0 || row < 0 || row >= LIST_VISIBLE_ROWS) {
+        return {};
+    }
+    return {0, LIST_TOP + row * LIST_ROW_HEIGHT, SCREEN_WIDTH, LIST_ENTRY_HEIGHT};
+}
+
+// Keeps the selected entry visible
+uint32_t GetEnvironmentListScrollOffset(uint32_t selected, uint32_t scrollOffset) {
+    if (selected < scrollOffset) {
+        return selected;
+    }
+    if (selected >= scrollOffset + LIST_VISIBLE_ROWS) {
+        return selected - LIST_VISIBLE_ROWS + 1;
+    }
+    return scrollOffset;
+}
+
+#define MENU_TITLE            "Environment Loader"
+#define MENU_VERSION          ENVIRONMENT_LOADER_VERSION ENVIRONMENT_LOADER_VERSION_EXTRA
+#define MENU_NO_ENVIRONMENTS  "No valid environments found. Press \ue000 to launch the Wii U Menu"
+#define MENU_HINT_NAVIGATE    "\ue07d Navigate "
+#define MENU_HINT_CHOOSE      "\ue000 Choose"
+#define MENU_HINT_AUTOBOOT    "\ue002/\ue046 Clear Default / \ue003/\ue045 Select Default"
+#define MENU_HINT_WII_U_MENU  "\ue000 Wii U Menu"
+
+// Every text DrawEnvironmentMenu may print, with the font size it uses. The visible environments come first.
+std::vector<TextRun> GetEnvironmentMenuTexts(const std::map<std::string, std::string> &payloads) {
+    std::vector<TextRun> texts = {
+            {MENU_TITLE, 24},
+            {MENU_VERSION, 16},
+    };
+    if (payloads.empty()) {
+        texts.push_back({MENU_NO_ENVIRONMENTS, 24});
+        texts.push_back({MENU_HINT_WII_U_MENU, 18});
+        return texts;
+    }
+    texts.push_back({MENU_HINT_NAVIGATE, 18});
+    texts.push_back({MENU_HINT_CHOOSE, 18});
+    texts.push_back({MENU_HINT_AUTOBOOT, 18});
+    for (auto const &[name, path] : payloads) {
+        texts.push_back({name.c_str(), 24});
+    }
+    return texts;
+}
+
+// Draws all parts of the environment menu that intersect area.
+void DrawEnvironmentMenu(const std::map<std::string, std::string> &payloads, uint32_t selected, int autoBoot, uint32_t scrollOffset, const IconCache &icons, uint32_t iconsReady, const Rect &area) {
+    if (!payloads.empty()) {
+        // Only the visible rows are laid out and drawn
+        uint32_t i = std::min<uint32_t>(scrollOffset, payloads.size());
+        for (auto it = std::next(payloads.begin(), i); it != payloads.end() && i < scrollOffset + LIST_VISIBLE_ROWS; ++it, ++i) {
+            Rect entry = GetEnvironmentEntryRect(i, scrollOffset);
+            if (!area.Intersects(entry)) {
+                continue;
+            }
+            uint32_t index = entry.y;
+            if (i == selected) {
+                DrawUtils::drawRect(16, index, SCREEN_WIDTH - 16 * 2, 44, 4, COLOR_BORDER_HIGHLIGHTED);
+            } else {
+                DrawUtils::drawRect(16, index, SCREEN_WIDTH - 16 * 2, 44, 2, ((int32_t) i == autoBoot) ? COLOR_AUTOBOOT : COLOR_BORDER);
+            }
+
+            if (i >= iconsReady) {
+                // placeholder until the icon has been loaded
+                DrawUtils::drawRectFilled(16 + 8, index + 4, IconCache::ICON_SIZE, IconCache::ICON_SIZE, COLOR_ICON_PLACEHOLDER);
+            } else if (auto *icon = icons.GetIcon(i)) {
+                DrawUtils::drawImage(16 + 8, index + 4, *icon);
+            }
+
+            DrawUtils::setFontSize(24);
+            DrawUtils::setFontColor(((int32_t) i == autoBoot) ? COLOR_AUTOBOOT : COLOR_TEXT);
+            DrawUtils::print(16 + 8 + IconCache::ICON_SIZE + 8, index + 8 + 24, it->first);
+        }
+
+        // draw scroll bar
+        if (payloads.size() > LIST_VISIBLE_ROWS && area.Intersects(GetEnvironmentListRect())) {
+            uint32_t trackHeight = LIST_BOTTOM - LIST_TOP;
+            uint32_t thumbHeight = std::max<uint32_t>(trackHeight * LIST_VISIBLE_ROWS / payloads.size(), 8);
+            uint32_t thumbY      = LIST_TOP + (trackHeight - thumbHeight) * scrollOffset / (payloads.size() - LIST_VISIBLE_ROWS);
+            DrawUtils::drawRectFilled(SCREEN_WIDTH - 12, LIST_TOP, 4, trackHeight, COLOR_ICON_PLACEHOLDER);
+            DrawUtils::drawRectFilled(SCREEN_WIDTH - 12, thumbY, 4, thumbHeight, COLOR_BORDER);
+        }
+    } else if (area.Intersects({0, SCREEN_HEIGHT / 2 - 32, SCREEN_WIDTH, 48})) {
+        DrawUtils::setFontSize(24);
+        DrawUtils::setFontColor(COLOR_RED);
+        DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(MENU_NO_ENVIRONMENTS) / 2, SCREEN_HEIGHT / 2, MENU_NO_ENVIRONMENTS, true);
+    }
+
+    DrawUtils::setFontColor(COLOR_TEXT);
+
+    // draw top bar
+    if (area.Intersects({0, 0, SCREEN_WIDTH, 8 + 24 + 4 + 3})) {
+        DrawUtils::setFontSize(24);
+        DrawUtils::print(16, 6 + 24, MENU_TITLE);
+        DrawUtils::drawRectFilled(8, 8 + 24 + 4, SCREEN_WIDTH - 8 * 2, 3, COLOR_WHITE);
+        DrawUtils::setFontSize(16);
+        DrawUtils::print(SCREEN_WIDTH - 16, 6 + 24, MENU_VERSION, true);
+    }
+
+    // draw bottom bar
+    if (area.Intersects({0, SCREEN_HEIGHT - 24 - 8 - 4, SCREEN_WIDTH, 24 + 8 + 4})) {
+        DrawUtils::drawRectFilled(8, SCREEN_HEIGHT - 24 - 8 - 4, SCREEN_WIDTH - 8 * 2, 3, COLOR_WHITE);
+        DrawUtils::setFontSize(18);
+        if (!payloads.empty()) {
+            DrawUtils::print(16, SCREEN_HEIGHT - 8, MENU_HINT_NAVIGATE);
+            DrawUtils::print(SCREEN_WIDTH - 16, SCREEN_HEIGHT - 8, MENU_HINT_CHOOSE, true);
+            DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(MENU_HINT_AUTOBOOT) / 2, SCREEN_HEIGHT - 8, MENU_HINT_AUTOBOOT, true);
+        } else {
+            DrawUtils::print(SCREEN_WIDTH - 20, SCREEN_HEIGHT - 8, MENU_HINT_WII_U_MENU, true);
+        }
+    }
+}
+
 std::string EnvironmentSelectionScreen(const std::map<std::string, std::string> &payloads, int32_t autobootIndex) {
     // Close quick start menu is selection screen is displayed
     AbortQuickStartMenu();
 
+    if (!DrawUtils::initFont()) {
+        FATAL_ERROR("EnvironmentLoader: Failed to init font");
+    }
+    // Render the glyphs of the menu on the other cores while the screen is set up (or right away without worker cores).
+    DrawUtils::startPrerender(GetEnvironmentMenuTexts(payloads));
+
     // Clear saved frame buffer to reduce screen corruption
     ClearSavedFrameBuffers();
 
@@ -479,7 +800,7 @@ std::string EnvironmentSelectionScreen(const std::map<std::string, std::string>
 
     auto *screenBuffer = (uint8_t *) memalign(0x100, tvBufferSize + drcBufferSize);
     if (!screenBuffer) {
-        OSFatal("EnvironmentLoader: Fail to allocate screenBuffer");
+        FATAL_ERROR("EnvironmentLoader: Fail to allocate screenBuffer");
     }
     memset(screenBuffer, 0, tvBufferSize + drcBufferSize);
 
@@ -489,24 +810,42 @@ std::string EnvironmentSelectionScreen(const std::map<std::string, std::string>
     OSScreenEnableEx(SCREEN_TV, TRUE);
     OSScreenEnableEx(SCREEN_DRC, TRUE);
 
-    DrawUtils::initBuffers(screenBuffer, tvBufferSize, screenBuffer + tvBufferSize, drcBufferSize);
-
-    if (!DrawUtils::initFont()) {
-        OSFatal("EnvironmentLoader: Failed to init font");
+    if (!DrawUtils::initBuffers(screenBuffer, tvBufferSize, screenBuffer + tvBufferSize, drcBufferSize)) {
+        FATAL_ERROR("EnvironmentLoader: Failed to init buffers");
     }
 
+    DrawUtils::finishPrerender();
+
     uint32_t selected = autobootIndex > 0 ? autobootIndex : 0;
     int autoBoot      = autobootIndex;
 
     {
         PairMenu pairMenu;
+        DamageTracker damage;
+        damage.AddAll();
+        bool pairMenuShown = false;
+        FramePacer pacer;
+        IconCache icons(ICON_CACHE_PATH);
+        icons.Start(payloads);
+        uint32_t iconsReady   = 0;
+        uint32_t scrollOffset = GetEnvironmentListScrollOffset(selected, 0);
         while (true) {
-            if (pairMenu.ProcessPairScreen()) {
+            bool pairScreenDrawn = false;
+            if (pairMenu.ProcessPairScreen(pairScreenDrawn)) {
+                pairMenuShown = true;
+                pacer.EndFrame(pairScreenDrawn);
                 continue;
             }
+            if (pairMenuShown) {
+                // The pair screen has drawn over everything
+                pairMenuShown = false;
+                damage.AddAll();
+            }
 
             InputUtils::InputData input = InputUtils::getControllerInput();
 
+            uint32_t prevSelected = selected;
+            int prevAutoBoot      = autoBoot;
             if (input.trigger & VPAD_BUTTON_UP) {
                 if (selected > 0) {
                     selected--;
@@ -523,57 +862,49 @@ std::string EnvironmentSelectionScreen(const std::map<std::string, std::string>
                 autoBoot = selected;
             }
 
-
-            DrawUtils::beginDraw();
-            DrawUtils::clear(COLOR_BACKGROUND);
-
-            // draw buttons
-            uint32_t index = 8 + 24 + 8 + 4;
-            uint32_t i     = 0;
-            if (!payloads.empty()) {
-                for (auto const &[key, val] : payloads) {
-                    if (i == selected) {
-                        DrawUtils::drawRect(16, index, SCREEN_WIDTH - 16 * 2, 44, 4, COLOR_BORDER_HIGHLIGHTED);
-                    } else {
-                        DrawUtils::drawRect(16, index, SCREEN_WIDTH - 16 * 2, 44, 2, ((int32_t) i == autoBoot) ? COLOR_AUTOBOOT : COLOR_BORDER);
-                    }
-
-                    DrawUtils::setFontSize(24);
-                    DrawUtils::setFontColor(((int32_t) i == autoBoot) ? COLOR_AUTOBOOT : COLOR_TEXT);
-                    DrawUtils::print(16 * 2, index + 8 + 24, key.c_str());
-                    index += 42 + 8;
-                    i++;
+            if (selected != prevSelected) {
+                uint32_t newScrollOffset = GetEnvironmentListScrollOffset(selected, scrollOffset);
+                if (newScrollOffset != scrollOffset) {
+                    scrollOffset = newScrollOffset;
+                    damage.Add(GetEnvironmentListRect());
+                } else {
+                    damage.Add(GetEnvironmentEntryRect(prevSelected, scrollOffset));
+                    damage.Add(GetEnvironmentEntryRect(selected, scrollOffset));
                 }
-            } else {
-                DrawUtils::setFontSize(24);
-                DrawUtils::setFontColor(COLOR_RED);
-                const char *noEnvironmentsWarning = "No valid environments found. Press \ue000 to launch the Wii U Menu";
-                DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(noEnvironmentsWarning) / 2, SCREEN_HEIGHT / 2, noEnvironmentsWarning, true);
             }
-
-            DrawUtils::setFontColor(COLOR_TEXT);
-
-            // draw top bar
-            DrawUtils::setFontSize(24);
-            DrawUtils::print(16, 6 + 24, "Environment Loader");
-            DrawUtils::drawRectFilled(8, 8 + 24 + 4, SCREEN_WIDTH - 8 * 2, 3, COLOR_WHITE);
-            DrawUtils::setFontSize(16);
-            DrawUtils::print(SCREEN_WIDTH - 16, 6 + 24, ENVIRONMENT_LOADER_VERSION ENVIRONMENT_LOADER_VERSION_EXTRA, true);
-
-            // draw bottom bar
-            DrawUtils::drawRectFilled(8, SCREEN_HEIGHT - 24 - 8 - 4, SCREEN_WIDTH - 8 * 2, 3, COLOR_WHITE);
-            DrawUtils::setFontSize(18);
-            if (!payloads.empty()) {
-                DrawUtils::print(16, SCREEN_HEIGHT - 8, "\ue07d Navigate ");
-                DrawUtils::print(SCREEN_WIDTH - 16, SCREEN_HEIGHT - 8, "\ue000 Choose", true);
-                const char *autobootHints = "\ue002/\ue046 Clear Default / \ue003/\ue045 Select Default";
-                DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(autobootHints) / 2, SCREEN_HEIGHT - 8, autobootHints, true);
-            } else {
-                DrawUtils::print(SCREEN_WIDTH - 20, SCREEN_HEIGHT - 8, "\ue000 Wii U Menu", true);
+            if (autoBoot != prevAutoBoot) {
+                damage.Add(GetEnvironmentEntryRect(prevAutoBoot, scrollOffset));
+                damage.Add(GetEnvironmentEntryRect(autoBoot, scrollOffset));
+            }
+            uint32_t newIconsReady = icons.GetReadyCount();
+            for (; iconsReady < newIconsReady; iconsReady++) {
+                damage.Add(GetEnvironmentEntryRect(iconsReady, scrollOffset));
             }
 
-            DrawUtils::endDraw();
+            // Only repaint what has changed, the rest of the canvas is still valid.
+            Rect rects[DamageTracker::MAX_RECTS];
+            uint32_t rectCount = damage.GetRects(rects);
+            if (rectCount > 0) {
+                DrawUtils::beginDraw();
+                for (uint32_t i = 0; i < rectCount; i++) {
+                    DrawUtils::setClipRect(rects[i]);
+                    DrawUtils::drawRectFilled(rects[i].x, rects[i].y, rects[i].w, rects[i].h, COLOR_BACKGROUND);
+                    DrawEnvironmentMenu(payloads, selected, autoBoot, scrollOffset, icons, iconsReady, rects[i]);
+                }
+                DrawUtils::resetClipRect();
+                DrawUtils::endDraw();
+                if (input.trigger) {
+                    DEBUG_FUNCTION_LINE_VERBOSE("Input to present: %d us", (uint32_t) OSTicksToMicroseconds(OSGetTime() - input.timestamp));
+                }
+            }
+            damage.NextFrame();
+            // Without a worker core the icons are loaded here, one per frame, after the frame has been presented.
+            icons.LoadNext();
+            pacer.EndFrame(rectCount > 0);
         }
+
+        icons.Stop();
+        icons.SaveIfChanged();
     }
 
     DrawUtils::beginDraw();
@@ -581,6 +912,7 @@ std::string EnvironmentSelectionScreen(const std::map<std::string, std::string>
     DrawUtils::endDraw();
 
     DrawUtils::deinitFont();
+    DrawUtils::deinitBuffers();
 
     // Call GX2Init to shut down OSScreen
     GX2Init(nullptr);
@@ -43,7 +43,8 @@ uint32_t ModuleDataFactory::GetSizeOfModule(const ELFIO::elfio &reader) {
 }
 
 std::optional<std::unique_ptr<ModuleData>>
-ModuleDataFactory::load(const ELFIO::elfio &reader, const HeapWrapper &heapWrapper, relocation_trampoline_entry_t *trampoline_data, uint32_t trampoline_data_length) {
+ModuleDataFactory::load(const ELFIO::elfio &reader, const HeapWrapper &heapWrapper, relocation_trampoline_entry_t *trampoline_data, uint32_t trampoline_data_length,
+                        RelocationStats *stats) {
     auto moduleData = make_unique_nothrow<ModuleData>();
     if (!moduleData) {
         DEBUG_FUNCTION_LINE_ERR("Failed to allocate ModuleData");
@@ -113,10 +114,10 @@ ModuleDataFactory::load(const ELFIO::elfio &reader, const HeapWrapper &heapWrapp
 
                 if (destination + sectionSize > (uint32_t) text_data.data() + text_size) {
                     DEBUG_FUNCTION_LINE_ERR("Tried to overflow .text buffer. %08X > %08X", destination + sectionSize, (uint32_t) text_data.data() + text_data.size());
-                    OSFatal("EnvironmentLoader: Tried to overflow .text buffer");
+                    FATAL_ERROR("EnvironmentLoader: Tried to overflow .text buffer");
                 } else if (destination < (uint32_t) text_data.data()) {
                     DEBUG_FUNCTION_LINE_ERR("Tried to underflow .text buffer. %08X < %08X", destination, (uint32_t) text_data.data());
-                    OSFatal("EnvironmentLoader: Tried to underflow .text buffer");
+                    FATAL_ERROR("EnvironmentLoader: Tried to underflow .text buffer");
                 }
             } else if ((address >= 0x10000000) && address < 0xC0000000) {
                 destination += (uint32_t) data_data.data();
@@ -125,10 +126,10 @@ ModuleDataFactory::load(const ELFIO::elfio &reader, const HeapWrapper &heapWrapp
 
                 if (destination + sectionSize > (uint32_t) data_data.data() + data_data.size()) {
                     DEBUG_FUNCTION_LINE_ERR("Tried to overflow .data buffer. %08X > %08X", destination + sectionSize, (uint32_t) data_data.data() + data_data.size());
-                    OSFatal("EnvironmentLoader: Tried to overflow .data buffer");
+                    FATAL_ERROR("EnvironmentLoader: Tried to overflow .data buffer");
                 } else if (destination < (uint32_t) data_data.data()) {
                     DEBUG_FUNCTION_LINE_ERR("Tried to underflow .data buffer. %08X < %08X", destination, (uint32_t) data_data.data());
-                    OSFatal("EnvironmentLoader: Tried to underflow .data buffer");
+                    FATAL_ERROR("EnvironmentLoader: Tried to underflow .data buffer");
                 }
             } else if (address >= 0xC0000000) {
                 DEBUG_FUNCTION_LINE_ERR("Loading section from 0xC0000000 is NOT supported");
@@ -143,7 +144,7 @@ ModuleDataFactory::load(const ELFIO::elfio &reader, const HeapWrapper &heapWrapp
             uint32_t address_align = psec->get_addr_align();
             if ((destination & (address_align - 1)) != 0) {
                 DEBUG_FUNCTION_LINE_WARN("Address not aligned: %08X %08X", destination, address_align);
-                OSFatal("EnvironmentLoader: Address not aligned");
+                FATAL_ERROR("EnvironmentLoader: Address not aligned");
             }
 
             if (psec->get_type() == ELFIO::SHT_NOBITS) {
@@ -164,7 +165,8 @@ ModuleDataFactory::load(const ELFIO::elfio &reader, const HeapWrapper &heapWrapp
         ELFIO::section *psec = reader.sections[i];
         if ((psec->get_type() == ELFIO::SHT_PROGBITS || psec->get_type() == ELFIO::SHT_NOBITS) && (psec->get_flags() & ELFIO::SHF_ALLOC)) {
             DEBUG_FUNCTION_LINE("Linking (%d)... %s", i, psec->get_name().c_str());
-            if (!linkSection(reader, psec->get_index(), (uint32_t) destinations[psec->get_index()], (uint32_t) (text_data.data()), (uint32_t) (data_data.data()), trampoline_data, trampoline_data_length)) {
+            if (!linkSection(reader, psec->get_index(), (uint32_t) destinations[psec->get_index()], (uint32_t) (text_data.data()), (uint32_t) (data_data.data()), trampoline_data, trampoline_data_length,
+                             stats)) {
                 DEBUG_FUNCTION_LINE_ERR("elfLink failed");
                 return std::nullopt;
             }
@@ -241,7 +243,7 @@ bool ModuleDataFactory::getImportRelocationData(std::unique_ptr<ModuleData> &mod
                 uint32_t section_index = psec->get_info();
                 if (!infoMap.contains(sym_section_index)) {
                     DEBUG_FUNCTION_LINE_ERR("Relocation is referencing a unknown section. %d destination: %08X sym_name %s", section_index, destinations[section_index], sym_name.c_str());
-                    OSFatal("EnvironmentLoader: Relocation is referencing a unknown section.");
+                    FATAL_ERROR("EnvironmentLoader: Relocation is referencing a unknown section.");
                     return false;
                 }
 
@@ -258,7 +260,7 @@ bool ModuleDataFactory::getImportRelocationData(std::unique_ptr<ModuleData> &mod
 }
 
 bool ModuleDataFactory::linkSection(const ELFIO::elfio &reader, uint32_t section_index, uint32_t destination, uint32_t base_text, uint32_t base_data, relocation_trampoline_entry_t *trampoline_data,
-                                    uint32_t trampoline_data_length) {
+                                    uint32_t trampoline_data_length, RelocationStats *stats) {
     uint32_t sec_num = reader.sections.size();
 
     for (uint32_t i = 0; i < sec_num; ++i) {
@@ -325,7 +327,7 @@ bool ModuleDataFactory::linkSection(const ELFIO::elfio &reader, uint32_t section
                     DEBUG_FUNCTION_LINE_ERR("NOT IMPLEMENTED: %04X", sym_section_index);
                     return false;
                 }
-                if (!ElfUtils::elfLinkOne(type, adjusted_offset, addend, destination, adjusted_sym_value, trampoline_data, trampoline_data_length, RELOC_TYPE_FIXED)) {
+                if (!ElfUtils::elfLinkOne(type, adjusted_offset, addend, destination, adjusted_sym_value, trampoline_data, trampoline_data_length, RELOC_TYPE_FIXED, stats)) {
                     DEBUG_FUNCTION_LINE_ERR("Link failed");
                     return false;
                 }
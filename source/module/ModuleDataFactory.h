@@ -18,6 +18,7 @@
 #pragma once
 
 #include "../common/relocation_defines.h"
+#include "ElfUtils.h"
 #include "ModuleData.h"
 #include "elfio/elfio.hpp"
 #include "utils/MemoryUtils.h"
@@ -30,10 +31,11 @@ class ModuleDataFactory {
 public:
     static uint32_t GetSizeOfModule(const ELFIO::elfio &reader);
 
-    static std::optional<std::unique_ptr<ModuleData>> load(const ELFIO::elfio &reader, const HeapWrapper &heapWrapper, relocation_trampoline_entry_t *trampoline_data, uint32_t trampoline_data_length);
+    static std::optional<std::unique_ptr<ModuleData>> load(const ELFIO::elfio &reader, const HeapWrapper &heapWrapper, relocation_trampoline_entry_t *trampoline_data, uint32_t trampoline_data_length,
+                                                           RelocationStats *stats = nullptr);
 
     static bool linkSection(const ELFIO::elfio &reader, uint32_t section_index, uint32_t destination, uint32_t base_text, uint32_t base_data, relocation_trampoline_entry_t *trampoline_data,
-                            uint32_t trampoline_data_length);
+                            uint32_t trampoline_data_length, RelocationStats *stats = nullptr);
 
     static bool getImportRelocationData(std::unique_ptr<ModuleData> &moduleData, const ELFIO::elfio &reader, uint8_t **destinations);
 };
@@ -0,0 +1,221 @@
+// The paired single kernels (ESPRESSO) can't be run by the host tests in tests/, only the integer versions are tested there.
+// Debug builds compare them with the integer versions on the console instead, see SelfCheck.
+#include "BlendKernels.h"
+#ifdef DEBUG
+#include "logger.h"
+#endif
+
+namespace {
+    inline uint32_t KeepAlpha(uint32_t dst, uint32_t color) {
+        return (color & 0xFFFFFF00) | (dst & 0xFF);
+    }
+
+    // Approximates v / 255 for both 16 bit lanes of v
+    inline uint32_t Div255x2(uint32_t v) {
+        return ((v + 0x00010001 + ((v >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    }
+
+    inline uint32_t BlendPixelInt(uint32_t dst, uint32_t src, uint32_t alpha) {
+        uint32_t invAlpha = 255 - alpha;
+        uint32_t rb       = ((src >> 8) & 0x00FF00FF) * alpha + ((dst >> 8) & 0x00FF00FF) * invAlpha;
+        uint32_t g        = ((src >> 16) & 0xFF) * alpha + ((dst >> 16) & 0xFF) * invAlpha;
+        return (Div255x2(rb) << 8) | (Div255x2(g) << 16) | (dst & 0xFF);
+    }
+
+    inline uint32_t BlitPixelInt(uint32_t dst, uint32_t src) {
+        uint32_t invAlpha = 255 - (src & 0xFF);
+        uint32_t rb       = Div255x2(((dst >> 8) & 0x00FF00FF) * invAlpha) + ((src >> 8) & 0x00FF00FF);
+        uint32_t g        = Div255x2(((dst >> 16) & 0xFF) * invAlpha) + ((src >> 16) & 0xFF);
+        return (rb << 8) | (g << 16) | (dst & 0xFF);
+    }
+
+#ifdef ESPRESSO
+    // GQR2 is switched to unscaled u8 loads and stores while the kernels run.
+#define BLEND_GQR_SPR "914"
+#define GQR_U8        0x00040004
+
+    class QuantizationScope {
+    public:
+        QuantizationScope() {
+            asm volatile("mfspr %0, " BLEND_GQR_SPR : "=r"(mSaved));
+            asm volatile("mtspr " BLEND_GQR_SPR ", %0" : : "r"(GQR_U8));
+        }
+
+        ~QuantizationScope() {
+            asm volatile("mtspr " BLEND_GQR_SPR ", %0" : : "r"(mSaved));
+        }
+
+    private:
+        uint32_t mSaved = 0;
+    };
+
+    // dst = dst + (color - dst) * alpha for r, g and b. alpha is 0.0 - 1.0.
+    // Quantized stores truncate, so the result can be one lower than the integer version.
+    inline void BlendPixel(uint32_t *dst, const uint32_t *color, float alpha) {
+        double d0, d1, c0, c1;
+        asm volatile(
+                "psq_l      %[d0], 0(%[dst]), 0, 2\n"
+                "psq_l      %[d1], 2(%[dst]), 0, 2\n"
+                "psq_l      %[c0], 0(%[col]), 0, 2\n"
+                "psq_l      %[c1], 2(%[col]), 0, 2\n"
+                "ps_sub     %[c0], %[c0], %[d0]\n"
+                "ps_sub     %[c1], %[c1], %[d1]\n"
+                "ps_madds0  %[c0], %[c0], %[a], %[d0]\n"
+                "ps_madds0  %[c1], %[c1], %[a], %[d1]\n"
+                "ps_merge01 %[c1], %[c1], %[d1]\n"
+                "psq_st     %[c0], 0(%[dst]), 0, 2\n"
+                "psq_st     %[c1], 2(%[dst]), 0, 2\n"
+                : [d0] "=&f"(d0), [d1] "=&f"(d1), [c0] "=&f"(c0), [c1] "=&f"(c1)
+                : [dst] "b"(dst), [col] "b"(color), [a] "f"(alpha)
+                : "memory");
+    }
+
+    // dst = src + dst * invAlpha for r, g and b, src is premultiplied.
+    inline void BlitPixel(uint32_t *dst, const uint32_t *src, float invAlpha) {
+        double d0, d1, s0, s1;
+        asm volatile(
+                "psq_l      %[d0], 0(%[dst]), 0, 2\n"
+                "psq_l      %[d1], 2(%[dst]), 0, 2\n"
+                "psq_l      %[s0], 0(%[src]), 0, 2\n"
+                "psq_l      %[s1], 2(%[src]), 0, 2\n"
+                "ps_madds0  %[s0], %[d0], %[a], %[s0]\n"
+                "ps_madds0  %[s1], %[d1], %[a], %[s1]\n"
+                "ps_merge01 %[s1], %[s1], %[d1]\n"
+                "psq_st     %[s0], 0(%[dst]), 0, 2\n"
+                "psq_st     %[s1], 2(%[dst]), 0, 2\n"
+                : [d0] "=&f"(d0), [d1] "=&f"(d1), [s0] "=&f"(s0), [s1] "=&f"(s1)
+                : [dst] "b"(dst), [src] "b"(src), [a] "f"(invAlpha)
+                : "memory");
+    }
+#endif
+} // namespace
+
+void BlendKernels::FillSpan(uint32_t *dst, uint32_t count, uint32_t color, uint32_t alpha) {
+    if (alpha == 0xFF) {
+        for (uint32_t i = 0; i < count; i++) {
+            dst[i] = KeepAlpha(dst[i], color);
+        }
+        return;
+    }
+    if (alpha == 0) {
+        return;
+    }
+#ifdef ESPRESSO
+    QuantizationScope gqr;
+    float a = (float) alpha * (1.0f / 255.0f);
+    for (uint32_t i = 0; i < count; i++) {
+        BlendPixel(&dst[i], &color, a);
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        dst[i] = BlendPixelInt(dst[i], color, alpha);
+    }
+#endif
+}
+
+void BlendKernels::BlendCoverageSpan(uint32_t *dst, const uint8_t *coverage, uint32_t count, uint32_t color, uint32_t alpha) {
+#ifdef ESPRESSO
+    QuantizationScope gqr;
+    float scale = (float) alpha * (1.0f / (255.0f * 255.0f));
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t weight = coverage[i] * alpha;
+        if (weight == 255 * 255) {
+            dst[i] = KeepAlpha(dst[i], color);
+        } else if (weight != 0) {
+            BlendPixel(&dst[i], &color, (float) coverage[i] * scale);
+        }
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t a = Div255x2(coverage[i] * alpha);
+        if (a == 0xFF) {
+            dst[i] = KeepAlpha(dst[i], color);
+        } else if (a != 0) {
+            dst[i] = BlendPixelInt(dst[i], color, a);
+        }
+    }
+#endif
+}
+
+void BlendKernels::BlitSpan(uint32_t *dst, const uint32_t *src, uint32_t count) {
+#ifdef ESPRESSO
+    QuantizationScope gqr;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t a = src[i] & 0xFF;
+        if (a == 0xFF) {
+            dst[i] = KeepAlpha(dst[i], src[i]);
+        } else if (a != 0) {
+            BlitPixel(&dst[i], &src[i], (float) (255 - a) * (1.0f / 255.0f));
+        }
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t a = src[i] & 0xFF;
+        if (a == 0xFF) {
+            dst[i] = KeepAlpha(dst[i], src[i]);
+        } else if (a != 0) {
+            dst[i] = BlitPixelInt(dst[i], src[i]);
+        }
+    }
+#endif
+}
+
+#ifdef DEBUG
+#ifdef ESPRESSO
+namespace {
+    // Quantized stores truncate, so the paired single kernels may be one lower per channel.
+    bool CloseEnough(uint32_t actual, uint32_t expected) {
+        for (uint32_t shift = 0; shift < 32; shift += 8) {
+            int32_t diff = (int32_t) ((actual >> shift) & 0xFF) - (int32_t) ((expected >> shift) & 0xFF);
+            if (diff < -1 || diff > 1 || (shift == 0 && diff != 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+#endif
+
+bool BlendKernels::SelfCheck() {
+#ifdef ESPRESSO
+    const uint32_t colors[] = {0x00000000, 0xFFFFFFFF, 0x7F7F7F80, 0xFF0000FF, 0x00FF0001, 0x0000FF7F, 0x12345678, 0xEDCBA987};
+    uint32_t failures       = 0;
+    auto check              = [&failures](const char *kernel, uint32_t actual, uint32_t expected, uint32_t dst, uint32_t color, uint32_t alpha) {
+        if (!CloseEnough(actual, expected) && failures++ < 8) {
+            DEBUG_FUNCTION_LINE_ERR("%s(%08X, %08X, %d) returned %08X, expected %08X", kernel, dst, color, alpha, actual, expected);
+        }
+    };
+
+    for (uint32_t dst : colors) {
+        for (uint32_t color : colors) {
+            for (uint32_t alpha = 0; alpha <= 0xFF; alpha++) {
+                uint32_t pixel = dst;
+                FillSpan(&pixel, 1, color, alpha);
+                check("FillSpan", pixel, alpha == 0xFF ? KeepAlpha(dst, color) : alpha == 0 ? dst : BlendPixelInt(dst, color, alpha), dst, color, alpha);
+
+                // Full alpha, the coverage decides
+                pixel         = dst;
+                auto coverage = (uint8_t) alpha;
+                uint32_t a    = Div255x2(coverage * 0xFF);
+                BlendCoverageSpan(&pixel, &coverage, 1, color, 0xFF);
+                check("BlendCoverageSpan", pixel, a == 0xFF ? KeepAlpha(dst, color) : a == 0 ? dst : BlendPixelInt(dst, color, a), dst, color, alpha);
+
+                // src has to be premultiplied
+                uint32_t src = ((((color >> 24) * alpha / 255) << 24) | ((((color >> 16) & 0xFF) * alpha / 255) << 16) |
+                                ((((color >> 8) & 0xFF) * alpha / 255) << 8) | alpha);
+                pixel        = dst;
+                BlitSpan(&pixel, &src, 1);
+                check("BlitSpan", pixel, alpha == 0xFF ? KeepAlpha(dst, src) : alpha == 0 ? dst : BlitPixelInt(dst, src), dst, src, alpha);
+            }
+        }
+    }
+
+    if (failures != 0) {
+        DEBUG_FUNCTION_LINE_ERR("Paired single blend kernels differ from the integer versions in %d cases", failures);
+        return false;
+    }
+    DEBUG_FUNCTION_LINE_VERBOSE("Paired single blend kernels match the integer versions");
+#endif
+    return true;
+}
+#endif
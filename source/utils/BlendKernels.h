@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Span kernels for 0xRRGGBBAA pixels. The alpha channel of the destination is always kept.
+ * On Espresso the blending is done with paired singles, everywhere else with integer math.
+ */
+namespace BlendKernels {
+    //! Fills count pixels with color, blended with alpha (0-255).
+    void FillSpan(uint32_t *dst, uint32_t count, uint32_t color, uint32_t alpha);
+
+    //! Blends color into count pixels, weighted by coverage[i] * alpha / 255.
+    void BlendCoverageSpan(uint32_t *dst, const uint8_t *coverage, uint32_t count, uint32_t color, uint32_t alpha);
+
+    //! Draws count premultiplied pixels over dst.
+    void BlitSpan(uint32_t *dst, const uint32_t *src, uint32_t count);
+
+#ifdef DEBUG
+    //! Compares the paired single kernels with the integer versions for every alpha and logs the differences.
+    //! Returns true if they match (within the truncation of quantized stores) or if the integer versions are used anyway.
+    bool SelfCheck();
+#endif
+} // namespace BlendKernels
@@ -0,0 +1,161 @@
+#include "BootConfig.h"
+#include "logger.h"
+#include <charconv>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BOOT_CONFIG_FILENAME "boot.cfg"
+#define BOOT_CONFIG_MAX_SIZE 0x400
+
+namespace {
+    std::string_view Trim(std::string_view str) {
+        while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+            str.remove_prefix(1);
+        }
+        while (!str.empty() && (str.back() == ' ' || str.back() == '\t' || str.back() == '\r')) {
+            str.remove_suffix(1);
+        }
+        return str;
+    }
+
+    bool ParseUInt(std::string_view value, uint32_t &out) {
+        int base = 10;
+        if (value.starts_with("0x") || value.starts_with("0X")) {
+            value.remove_prefix(2);
+            base = 16;
+        }
+        uint32_t result = 0;
+        auto [ptr, ec]  = std::from_chars(value.data(), value.data() + value.size(), result, base);
+        if (ec != std::errc() || ptr != value.data() + value.size() || value.empty()) {
+            return false;
+        }
+        out = result;
+        return true;
+    }
+
+    bool ParseBool(std::string_view value, bool &out) {
+        if (value == "1" || value == "true" || value == "on") {
+            out = true;
+            return true;
+        }
+        if (value == "0" || value == "false" || value == "off") {
+            out = false;
+            return true;
+        }
+        return false;
+    }
+} // namespace
+
+BootConfig BootConfig::Load(std::string_view environmentPath) {
+    BootConfig config;
+
+    char path[0x100];
+    if (snprintf(path, sizeof(path), "%.*s/" BOOT_CONFIG_FILENAME, (int) environmentPath.size(), environmentPath.data()) >= (int) sizeof(path)) {
+        DEBUG_FUNCTION_LINE_ERR("Environment path is too long");
+        return config;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        DEBUG_FUNCTION_LINE_VERBOSE("No boot config found at %s", path);
+        return config;
+    }
+
+    char buffer[BOOT_CONFIG_MAX_SIZE];
+    ssize_t readBytes = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (readBytes < 0) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to read %s", path);
+        return config;
+    }
+    if (readBytes == sizeof(buffer)) {
+        DEBUG_FUNCTION_LINE_WARN("%s is bigger than %d bytes, the remaining content is ignored", path, BOOT_CONFIG_MAX_SIZE);
+    }
+
+    Parse(std::string_view(buffer, readBytes), config);
+    return config;
+}
+
+void BootConfig::Parse(std::string_view content, BootConfig &config) {
+    // prefetch is enabled by default, only warn about it if it has been enabled explicitly.
+    bool prefetchSet = false;
+    while (!content.empty()) {
+        auto lineEnd          = content.find('\n');
+        std::string_view line = content.substr(0, lineEnd);
+        content.remove_prefix(lineEnd == std::string_view::npos ? content.size() : lineEnd + 1);
+
+        line = Trim(line);
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+
+        auto separator = line.find('=');
+        if (separator == std::string_view::npos) {
+            DEBUG_FUNCTION_LINE_WARN("Ignore invalid line in boot config: %.*s", (int) line.size(), line.data());
+            continue;
+        }
+        std::string_view key   = Trim(line.substr(0, separator));
+        std::string_view value = Trim(line.substr(separator + 1));
+
+        bool valid = true;
+        if (key == "prefetch") {
+            valid       = ParseBool(value, config.prefetch);
+            prefetchSet = valid && config.prefetch;
+        } else if (key == "loader_threads") {
+            valid = ParseUInt(value, config.loaderThreads);
+            if (config.loaderThreads > 2) {
+                config.loaderThreads = 2;
+            }
+        } else if (key == "heap_margin") {
+            valid = ParseUInt(value, config.heapMargin);
+        } else if (key == "trace") {
+            valid = ParseBool(value, config.trace);
+        } else if (key == "boot_report") {
+            valid = ParseBool(value, config.bootReport);
+        } else if (key == "boot_history") {
+            valid = ParseUInt(value, config.bootHistory);
+            if (config.bootHistory > 64) {
+                config.bootHistory = 64;
+            }
+        } else if (key == "regression_threshold") {
+            valid = ParseUInt(value, config.regressionThreshold);
+        } else if (key == "log_level") {
+            valid = parseLogLevel(value.data(), value.size(), &config.logLevel);
+        } else if (key == "boot_key_window_ms") {
+            valid = ParseUInt(value, config.bootKeyWindowMs);
+            if (config.bootKeyWindowMs > 1000) {
+                config.bootKeyWindowMs = 1000;
+            }
+        } else if (key == "boot_key_kpad") {
+            valid = ParseBool(value, config.bootKeyKPAD);
+        } else if (key == "display_setup") {
+            if (value == "sync") {
+                config.displaySetup = DISPLAY_SETUP_SYNC;
+            } else if (value == "async") {
+                config.displaySetup = DISPLAY_SETUP_ASYNC;
+            } else if (value == "skip") {
+                config.displaySetup = DISPLAY_SETUP_SKIP;
+            } else {
+                valid = false;
+            }
+        } else {
+            DEBUG_FUNCTION_LINE_WARN("Ignore unknown key in boot config: %.*s", (int) key.size(), key.data());
+            continue;
+        }
+
+        if (!valid) {
+            DEBUG_FUNCTION_LINE_WARN("Ignore invalid value for %.*s: %.*s", (int) key.size(), key.data(), (int) value.size(), value.data());
+        }
+    }
+
+    // Both need a worker core, see CoreThread.
+    if (config.loaderThreads == 0) {
+        if (config.displaySetup == DISPLAY_SETUP_ASYNC) {
+            DEBUG_FUNCTION_LINE_WARN("display_setup=async needs loader_threads, the display is set up synchronously instead");
+        }
+        if (prefetchSet) {
+            DEBUG_FUNCTION_LINE_WARN("prefetch needs loader_threads, setup modules are read without prefetching instead");
+        }
+    }
+}
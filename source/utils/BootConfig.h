@@ -0,0 +1,48 @@
+#pragma once
+
+#include "logger.h"
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Per-environment settings to tune the boot, read from "[ENVIRONMENT]/boot.cfg".
+ * The file consists of "key=value" lines, empty lines and lines starting with '#' are ignored.
+ * Unknown keys and invalid values are ignored, missing keys keep their default value.
+ */
+class BootConfig {
+public:
+    enum DisplaySetupMode {
+        DISPLAY_SETUP_SYNC,  // Clear the saved frames and shut down OSScreen before loading the first module
+        DISPLAY_SETUP_ASYNC, // Same as sync, but on a worker core while the first module is read and linked
+        DISPLAY_SETUP_SKIP,  // Leave the display as it is
+    };
+
+    //! Load the next setup module in the background while the current one is linked, requires loaderThreads.
+    bool prefetch = true;
+    //! How many of the two other cores the loader may use for background work. Disabled by default, see CoreThread.
+    uint32_t loaderThreads = 0;
+    //! Additional memory reserved for each setup module on top of its sections.
+    uint32_t heapMargin = 0x10000;
+    //! Log the duration of each phase of the boot.
+    bool trace = false;
+    //! Write the metrics of each setup module to "sd:/wiiu/environments/last_boot.csv".
+    bool bootReport = true;
+    //! How many boots are kept in "sd:/wiiu/environments/boot_history.bin" to detect regressions, 0 disables the history.
+    uint32_t bootHistory = 8;
+    //! Flag modules that read or link this many percent slower than in the previous boots, 0 disables the check.
+    uint32_t regressionThreshold = 25;
+    //! One of LOG_LEVEL_*, allows debugging a boot without a debug build.
+    uint32_t logLevel = LOG_LEVEL_DEFAULT;
+    //! How to set up the display when the menu hasn't been shown.
+    DisplaySetupMode displaySetup = DISPLAY_SETUP_SYNC;
+    //! How long to wait for the button that opens the menu (read from the default environment).
+    uint32_t bootKeyWindowMs = 50;
+    //! Also check Wiimotes and Pro Controllers for the button, this requires initializing KPAD on every boot.
+    bool bootKeyKPAD = false;
+
+    //! Reads and parses "[environmentPath]/boot.cfg" with a single read. Returns the defaults if the file doesn't exist.
+    static BootConfig Load(std::string_view environmentPath);
+
+    //! Parses the given file content in place without allocating.
+    static void Parse(std::string_view content, BootConfig &config);
+};
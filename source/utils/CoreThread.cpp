@@ -0,0 +1,81 @@
+#include "CoreThread.h"
+#include "logger.h"
+#include <cstdlib>
+#include <malloc.h>
+
+static uint32_t workerCount = 0;
+
+CoreThread::~CoreThread() {
+    Join();
+}
+
+bool CoreThread::Start(std::function<void()> &&func, OSThreadAttributes affinity, const char *name, int32_t priority, uint32_t stackSize) {
+    if (mThread) {
+        DEBUG_FUNCTION_LINE_ERR("Thread %s has already been started", name);
+        return false;
+    }
+    if (workerCount == 0) {
+        DEBUG_FUNCTION_LINE_VERBOSE("Worker cores are disabled, don't start thread %s", name);
+        return false;
+    }
+
+    mThread = (OSThread *) memalign(0x10, sizeof(OSThread));
+    mStack  = (uint8_t *) memalign(0x20, stackSize);
+    if (!mThread || !mStack) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to allocate thread %s", name);
+        free(mThread);
+        free(mStack);
+        mThread = nullptr;
+        mStack  = nullptr;
+        return false;
+    }
+
+    mFunc = std::move(func);
+    if (!OSCreateThread(mThread, &CoreThread::ThreadEntry, 0, (char *) this, mStack + stackSize, stackSize, priority, affinity)) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to create thread %s", name);
+        free(mThread);
+        free(mStack);
+        mThread = nullptr;
+        mStack  = nullptr;
+        mFunc   = {};
+        return false;
+    }
+    OSSetThreadName(mThread, name);
+    OSResumeThread(mThread);
+    return true;
+}
+
+void CoreThread::Join() {
+    if (!mThread) {
+        return;
+    }
+    OSJoinThread(mThread, nullptr);
+    free(mThread);
+    free(mStack);
+    mThread = nullptr;
+    mStack  = nullptr;
+    mFunc   = {};
+}
+
+OSThreadAttributes CoreThread::GetWorkerAffinity(uint32_t index) {
+    if (workerCount < 2) {
+        index = 0;
+    }
+    // The main thread runs on core 1, so use core 2 and core 0 for workers.
+    return (index % 2) == 0 ? OS_THREAD_ATTRIB_AFFINITY_CPU2 : OS_THREAD_ATTRIB_AFFINITY_CPU0;
+}
+
+void CoreThread::SetWorkerCount(uint32_t count) {
+    workerCount = count > 2 ? 2 : count;
+}
+
+uint32_t CoreThread::GetWorkerCount() {
+    return workerCount;
+}
+
+int CoreThread::ThreadEntry(int argc, const char **argv) {
+    (void) argc;
+    auto *thread = (CoreThread *) argv;
+    thread->mFunc();
+    return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <coreinit/thread.h>
+#include <cstdint>
+#include <functional>
+
+/**
+ * Runs a single function on a dedicated OSThread, usually pinned to one of the cores the main thread isn't using.
+ * The thread is joined by Join() or at the latest when the object is destroyed.
+ *
+ * Worker threads are disabled until SetWorkerCount() allows them (see BootConfig::loaderThreads). Without Aroma the loader
+ * itself runs from 0x00800000 - 0x01000000, which may only be mapped to the main core, so a thread on another core can't
+ * safely execute its code or touch its data. Start() fails while workers are disabled, callers then do the work themselves.
+ */
+class CoreThread {
+public:
+    CoreThread() = default;
+
+    ~CoreThread();
+
+    CoreThread(const CoreThread &) = delete;
+    CoreThread &operator=(const CoreThread &) = delete;
+
+    bool Start(std::function<void()> &&func, OSThreadAttributes affinity, const char *name, int32_t priority = 16, uint32_t stackSize = 0x8000);
+
+    //! Waits for the function to return. Does nothing if the thread was never started.
+    void Join();
+
+    [[nodiscard]] bool IsStarted() const {
+        return mThread != nullptr;
+    }
+
+    //! Returns the affinity for the n-th worker thread, skipping the main core. Only uses one core if a single worker is allowed.
+    static OSThreadAttributes GetWorkerAffinity(uint32_t index);
+
+    //! Sets how many of the other two cores may be used, 0 (the default) disables worker threads.
+    static void SetWorkerCount(uint32_t count);
+
+    static uint32_t GetWorkerCount();
+
+private:
+    static int ThreadEntry(int argc, const char **argv);
+
+    OSThread *mThread = nullptr;
+    uint8_t *mStack   = nullptr;
+    std::function<void()> mFunc;
+};
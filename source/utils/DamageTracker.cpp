@@ -0,0 +1,47 @@
+#include "DamageTracker.h"
+
+void DamageTracker::Add(const Rect &rect) {
+    if (rect.IsEmpty()) {
+        return;
+    }
+    for (uint32_t i = 0; i < mCurrent.count; i++) {
+        auto &cur = mCurrent.rects[i];
+        if (Rect{cur.x - 1, cur.y - 1, cur.w + 2, cur.h + 2}.Intersects(rect)) {
+            cur = cur.Union(rect);
+            return;
+        }
+    }
+    if (mCurrent.count == MAX_RECTS) {
+        mCurrent.rects[MAX_RECTS - 1] = mCurrent.rects[MAX_RECTS - 1].Union(rect);
+        return;
+    }
+    mCurrent.rects[mCurrent.count++] = rect;
+}
+
+void DamageTracker::AddAll() {
+    mCurrent.rects[0] = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    mCurrent.count    = 1;
+}
+
+uint32_t DamageTracker::GetRects(Rect (&out)[MAX_RECTS]) const {
+    for (uint32_t i = 0; i < mCurrent.count; i++) {
+        out[i] = mCurrent.rects[i];
+    }
+    return mCurrent.count;
+}
+
+uint32_t DamageTracker::GetFrameRects(Rect (&out)[MAX_RECTS * 2]) const {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < mCurrent.count; i++) {
+        out[count++] = mCurrent.rects[i];
+    }
+    for (uint32_t i = 0; i < mPrevious.count; i++) {
+        out[count++] = mPrevious.rects[i];
+    }
+    return count;
+}
+
+void DamageTracker::NextFrame() {
+    mPrevious      = mCurrent;
+    mCurrent.count = 0;
+}
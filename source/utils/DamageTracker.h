@@ -0,0 +1,39 @@
+#pragma once
+
+#include "DrawUtils.h"
+#include <cstdint>
+
+/**
+ * Collects the screen areas that changed since the last frame.
+ * OSScreen is double buffered, so the buffer we draw to still shows the frame before the previous one.
+ * GetFrameRects therefore returns the damage of this and of the previous frame.
+ * Rects that touch an already known rect are merged into it.
+ */
+class DamageTracker {
+public:
+    //! Once the list is full, new rects are merged into the last one.
+    static constexpr uint32_t MAX_RECTS = 8;
+
+    void Add(const Rect &rect);
+
+    //! Marks the whole screen as changed.
+    void AddAll();
+
+    //! Returns the number of rects that changed in this frame and fills out.
+    uint32_t GetRects(Rect (&out)[MAX_RECTS]) const;
+
+    //! Returns the number of rects that changed in this or the previous frame and fills out.
+    uint32_t GetFrameRects(Rect (&out)[MAX_RECTS * 2]) const;
+
+    //! Call once after the frame has been drawn (or skipped).
+    void NextFrame();
+
+private:
+    struct Region {
+        Rect rects[MAX_RECTS];
+        uint32_t count = 0;
+    };
+
+    Region mCurrent;
+    Region mPrevious;
+};
@@ -1,18 +1,32 @@
 #include "DrawUtils.h"
 
+#include "BlendKernels.h"
+#include "CoreThread.h"
+#include "DamageTracker.h"
+#include "GlyphCache.h"
+#include "ImageSurface.h"
+#include "Utf8Decoder.h"
 #include "logger.h"
 #include "utils.h"
 #include <coreinit/cache.h>
 #include <coreinit/memory.h>
 #include <coreinit/screen.h>
+#include <algorithm>
 #include <cstdlib>
-#include <png.h>
+#include <cstring>
+#include <malloc.h>
+#include <unordered_set>
 
 
 // buffer width
 #define TV_WIDTH  0x500
 #define DRC_WIDTH 0x380
 
+// Enough for every glyph the menu and the pair screen show at once
+#define GLYPH_CACHE_SIZE (128 * 1024)
+// Scratch memory of the fixed-point rasterizer, large glyphs that don't fit use the regular one.
+#define GLYPH_SCRATCH_SIZE (96 * 1024)
+
 bool DrawUtils::isBackBuffer;
 
 uint8_t *DrawUtils::tvBuffer  = nullptr;
@@ -22,12 +36,164 @@ uint32_t DrawUtils::drcSize   = 0;
 static SFT pFont              = {};
 
 static Color font_col(0xFFFFFFFF);
+static std::unique_ptr<GlyphCache> glyphCache;
+static std::unique_ptr<uint8_t[]> glyphScratch;
+
+// Glyphs rendered ahead of time by startPrerender. Every worker renders every PRERENDER_WORKERS-th glyph into
+// its own part of prerenderPixels, finishPrerender copies them into the glyph cache after joining the workers.
+#define PRERENDER_WORKERS 2
+
+struct PrerenderGlyph {
+    SFT_Glyph glyph;
+    uint32_t size;
+    SFT_GMetrics metrics;
+    uint32_t offset;
+    uint16_t width;
+    uint16_t height;
+    bool rendered;
+};
+static std::vector<PrerenderGlyph> prerenderGlyphs;
+static std::unique_ptr<uint8_t[]> prerenderPixels;
+static std::unique_ptr<uint8_t[]> prerenderScratch[PRERENDER_WORKERS];
+static CoreThread prerenderThreads[PRERENDER_WORKERS];
+static SFT prerenderFont = {};
+
+// Direct lookup tables for Basic Latin and the private use area that holds the button glyphs
+#define ASCII_GLYPH_FIRST   0x20
+#define ASCII_GLYPH_COUNT   0x5F
+#define PUA_GLYPH_FIRST     0xE000
+#define PUA_GLYPH_COUNT     0x100
+#define FAST_GLYPH_COUNT    (ASCII_GLYPH_COUNT + PUA_GLYPH_COUNT)
+#define FAST_GLYPH_UNKNOWN  0xFFFFFFFF
+#define FAST_GLYPH_MISSING  0xFFFFFFFE
+#define ADVANCE_CACHE_SIZES 4
+
+static uint32_t fastGlyphs[FAST_GLYPH_COUNT];
+
+// Truncated advance widths of the fast glyphs for a few font sizes, -1 means unknown.
+struct AdvanceCache {
+    uint32_t size;
+    int16_t advance[FAST_GLYPH_COUNT];
+};
+static AdvanceCache advanceCaches[ADVANCE_CACHE_SIZES];
+static AdvanceCache *currentAdvances = nullptr;
+static uint32_t nextAdvanceCache     = 0;
+
+// Remembers the width of recently measured strings
+#define TEXT_WIDTH_MEMO_SIZE       32
+#define TEXT_WIDTH_MEMO_MAX_LENGTH 64
+
+struct TextWidthMemo {
+    uint32_t hash;
+    uint32_t size;
+    uint32_t width;
+    uint32_t length;
+    char text[TEXT_WIDTH_MEMO_MAX_LENGTH];
+};
+static TextWidthMemo textWidthMemo[TEXT_WIDTH_MEMO_SIZE];
+static uint32_t nextTextWidthMemo = 0;
+
+// Everything is drawn into this SCREEN_WIDTH x SCREEN_HEIGHT canvas, endDraw copies the changed parts to the screens.
+static uint32_t *canvas = nullptr;
+static DamageTracker canvasDamage;
+
+// Pointers to the screen buffers that are currently not displayed, set in beginDraw
+static uint32_t *drcFrame = nullptr;
+static uint32_t *tvFrame  = nullptr;
+
+// Drawing is restricted to [clipX0, clipX1) x [clipY0, clipY1)
+static int32_t clipX0 = 0;
+static int32_t clipY0 = 0;
+static int32_t clipX1 = SCREEN_WIDTH;
+static int32_t clipY1 = SCREEN_HEIGHT;
+
+// Stride and usable size of the tv buffer
+static uint32_t tvWidth  = TV_WIDTH;
+static uint32_t tvHeight = 0;
+
+// Maps a DRC column/row to the first TV column/row it covers, the next entry is the (exclusive) end.
+static uint16_t tvColumnMap[SCREEN_WIDTH + 1];
+static uint16_t tvRowMap[SCREEN_HEIGHT + 1];
+
+bool DrawUtils::initBuffers(void *tvBuffer_, uint32_t tvSize_, void *drcBuffer_, uint32_t drcSize_) {
+    canvas = (uint32_t *) memalign(0x40, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    if (!canvas) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to allocate canvas");
+        return false;
+    }
+    memset(canvas, 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    // The screen buffers might not match the canvas yet
+    canvasDamage = {};
+    canvasDamage.AddAll();
+
+#ifdef DEBUG
+    BlendKernels::SelfCheck();
+#endif
 
-void DrawUtils::initBuffers(void *tvBuffer_, uint32_t tvSize_, void *drcBuffer_, uint32_t drcSize_) {
     DrawUtils::tvBuffer  = (uint8_t *) tvBuffer_;
     DrawUtils::tvSize    = tvSize_;
     DrawUtils::drcBuffer = (uint8_t *) drcBuffer_;
     DrawUtils::drcSize   = drcSize_;
+
+    // 16.16 fixed-point scale from DRC to TV
+    uint32_t scale = 0x18000;
+    tvWidth        = TV_WIDTH;
+    tvHeight       = 720;
+    if (DrawUtils::tvSize == 0x00FD2000) {
+        tvWidth  = 1920;
+        tvHeight = 1080;
+        scale    = 0x24000;
+    }
+    // Never write outside the buffer
+    if (tvHeight > (tvSize / 2) / (tvWidth * 4)) {
+        tvHeight = (tvSize / 2) / (tvWidth * 4);
+    }
+
+    for (uint32_t i = 0; i <= SCREEN_WIDTH; i++) {
+        tvColumnMap[i] = std::min<uint32_t>((i * scale) >> 16, tvWidth);
+    }
+    for (uint32_t i = 0; i <= SCREEN_HEIGHT; i++) {
+        tvRowMap[i] = std::min<uint32_t>((i * scale) >> 16, tvHeight);
+    }
+    return true;
+}
+
+void DrawUtils::deinitBuffers() {
+    free(canvas);
+    canvas = nullptr;
+}
+
+// Copies rect from the canvas to the DRC buffer and scales it into the TV buffer
+static void present_rect(const Rect &rect) {
+    int32_t x0 = std::clamp<int32_t>(rect.x, 0, SCREEN_WIDTH);
+    int32_t y0 = std::clamp<int32_t>(rect.y, 0, SCREEN_HEIGHT);
+    int32_t x1 = std::clamp<int32_t>(rect.x + rect.w, x0, SCREEN_WIDTH);
+    int32_t y1 = std::clamp<int32_t>(rect.y + rect.h, y0, SCREEN_HEIGHT);
+    if (x0 == x1 || y0 == y1) {
+        return;
+    }
+
+    uint32_t tvX0 = tvColumnMap[x0];
+    uint32_t tvW  = tvColumnMap[x1] - tvX0;
+    for (int32_t y = y0; y < y1; y++) {
+        const uint32_t *src = canvas + y * SCREEN_WIDTH;
+        memcpy(drcFrame + y * DRC_WIDTH + x0, src + x0, (x1 - x0) * sizeof(uint32_t));
+
+        if (tvRowMap[y] == tvRowMap[y + 1]) {
+            continue;
+        }
+        // Scale the first TV row of this canvas row, the others are copies of it.
+        uint32_t *tvRow = tvFrame + tvRowMap[y] * tvWidth;
+        for (int32_t x = x0; x < x1; x++) {
+            uint32_t pixel = src[x];
+            for (uint32_t tvX = tvColumnMap[x]; tvX < tvColumnMap[x + 1]; tvX++) {
+                tvRow[tvX] = pixel;
+            }
+        }
+        for (uint32_t tvY = tvRowMap[y] + 1; tvY < tvRowMap[y + 1]; tvY++) {
+            memcpy(tvFrame + tvY * tvWidth + tvX0, tvRow + tvX0, tvW * sizeof(uint32_t));
+        }
+    }
 }
 
 void DrawUtils::beginDraw() {
@@ -43,9 +209,19 @@ void DrawUtils::beginDraw() {
 
     // restore the pixel we used for checking
     *(uint32_t *) tvBuffer = pixel;
+
+    drcFrame = (uint32_t *) (drcBuffer + (isBackBuffer ? drcSize / 2 : 0));
+    tvFrame  = (uint32_t *) (tvBuffer + (isBackBuffer ? tvSize / 2 : 0));
 }
 
 void DrawUtils::endDraw() {
+    Rect rects[DamageTracker::MAX_RECTS * 2];
+    uint32_t rectCount = canvasDamage.GetFrameRects(rects);
+    for (uint32_t i = 0; i < rectCount; i++) {
+        present_rect(rects[i]);
+    }
+    canvasDamage.NextFrame();
+
     // OSScreenFlipBuffersEx already flushes the cache?
     // DCFlushRange(tvBuffer, tvSize);
     // DCFlushRange(drcBuffer, drcSize);
@@ -55,65 +231,53 @@ void DrawUtils::endDraw() {
 }
 
 void DrawUtils::clear(Color col) {
-    OSScreenClearBufferEx(SCREEN_TV, col.color);
-    OSScreenClearBufferEx(SCREEN_DRC, col.color);
+    std::fill_n(canvas, SCREEN_WIDTH * SCREEN_HEIGHT, col.color);
+    canvasDamage.AddAll();
 }
 
-void DrawUtils::drawPixel(uint32_t x, uint32_t y, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-    float opacity = a / 255.0f;
+void DrawUtils::setClipRect(const Rect &rect) {
+    clipX0 = std::clamp<int32_t>(rect.x, 0, SCREEN_WIDTH);
+    clipY0 = std::clamp<int32_t>(rect.y, 0, SCREEN_HEIGHT);
+    clipX1 = std::clamp<int32_t>(rect.x + rect.w, clipX0, SCREEN_WIDTH);
+    clipY1 = std::clamp<int32_t>(rect.y + rect.h, clipY0, SCREEN_HEIGHT);
+}
 
-    // put pixel in the drc buffer
-    uint32_t i = (x + y * DRC_WIDTH) * 4;
-    if (i + 3 < drcSize / 2) {
-        if (isBackBuffer) {
-            i += drcSize / 2;
-        }
-        if (a == 0xFF) {
-            drcBuffer[i]     = r;
-            drcBuffer[i + 1] = g;
-            drcBuffer[i + 2] = b;
-        } else {
-            drcBuffer[i]     = r * opacity + drcBuffer[i] * (1 - opacity);
-            drcBuffer[i + 1] = g * opacity + drcBuffer[i + 1] * (1 - opacity);
-            drcBuffer[i + 2] = b * opacity + drcBuffer[i + 2] * (1 - opacity);
-        }
-    }
+void DrawUtils::resetClipRect() {
+    clipX0 = 0;
+    clipY0 = 0;
+    clipX1 = SCREEN_WIDTH;
+    clipY1 = SCREEN_HEIGHT;
+}
 
-    uint32_t USED_TV_WIDTH = TV_WIDTH;
-    float scale            = 1.5f;
-    if (DrawUtils::tvSize == 0x00FD2000) {
-        USED_TV_WIDTH = 1920;
-        scale         = 2.25f;
-    }
-
-    // scale and put pixel in the tv buffer
-    for (uint32_t yy = (y * scale); yy < ((y * scale) + (uint32_t) scale); yy++) {
-        for (uint32_t xx = (x * scale); xx < ((x * scale) + (uint32_t) scale); xx++) {
-            uint32_t i = (xx + yy * USED_TV_WIDTH) * 4;
-            if (i + 3 < tvSize / 2) {
-                if (isBackBuffer) {
-                    i += tvSize / 2;
-                }
-                if (a == 0xFF) {
-                    tvBuffer[i]     = r;
-                    tvBuffer[i + 1] = g;
-                    tvBuffer[i + 2] = b;
-                } else {
-                    tvBuffer[i]     = r * opacity + tvBuffer[i] * (1 - opacity);
-                    tvBuffer[i + 1] = g * opacity + tvBuffer[i + 1] * (1 - opacity);
-                    tvBuffer[i + 2] = b * opacity + tvBuffer[i + 2] * (1 - opacity);
-                }
-            }
-        }
+void DrawUtils::addDamage(const Rect &rect) {
+    canvasDamage.Add(rect);
+}
+
+void DrawUtils::drawPixel(uint32_t x, uint32_t y, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    if ((int32_t) x < clipX0 || (int32_t) x >= clipX1 || (int32_t) y < clipY0 || (int32_t) y >= clipY1 || a == 0) {
+        return;
     }
+    // No damage rect per pixel, see addDamage.
+    BlendKernels::FillSpan(canvas + y * SCREEN_WIDTH + x, 1, Color(r, g, b, a).color, a);
 }
 
 void DrawUtils::drawRectFilled(uint32_t x, uint32_t y, uint32_t w, uint32_t h, Color col) {
+    int32_t x0 = std::max<int32_t>(x, clipX0);
+    int32_t y0 = std::max<int32_t>(y, clipY0);
+    int32_t x1 = std::min<int64_t>((int64_t) x + w, clipX1);
+    int32_t y1 = std::min<int64_t>((int64_t) y + h, clipY1);
+    if (x0 >= x1 || y0 >= y1 || col.a == 0) {
+        return;
+    }
+    x = x0;
+    y = y0;
+    w = x1 - x0;
+    h = y1 - y0;
+
     for (uint32_t yy = y; yy < y + h; yy++) {
-        for (uint32_t xx = x; xx < x + w; xx++) {
-            drawPixel(xx, yy, col);
-        }
+        BlendKernels::FillSpan(canvas + yy * SCREEN_WIDTH + x, w, col.color, col.a);
     }
+    canvasDamage.Add({(int32_t) x, (int32_t) y, (int32_t) w, (int32_t) h});
 }
 
 void DrawUtils::drawRect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t borderSize, Color col) {
@@ -123,83 +287,113 @@ void DrawUtils::drawRect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_
     drawRectFilled(x + w - borderSize, y, borderSize, h, col);
 }
 
-void DrawUtils::drawBitmap(uint32_t x, uint32_t y, uint32_t target_width, uint32_t target_height, const uint8_t *data) {
-    if (data[0] != 'B' || data[1] != 'M') {
-        // invalid header
+void DrawUtils::drawImage(uint32_t x, uint32_t y, const ImageSurface &image) {
+    Rect area = Rect{(int32_t) x, (int32_t) y, (int32_t) image.GetWidth(), (int32_t) image.GetHeight()}.Intersection({clipX0, clipY0, clipX1 - clipX0, clipY1 - clipY0});
+    if (area.IsEmpty()) {
         return;
     }
 
-    uint32_t dataPos = __builtin_bswap32(*(uint32_t *) &(data[0x0A]));
-    uint32_t width   = __builtin_bswap32(*(uint32_t *) &(data[0x12]));
-    uint32_t height  = __builtin_bswap32(*(uint32_t *) &(data[0x16]));
+    for (int32_t yy = area.y; yy < area.y + area.h; yy++) {
+        const uint32_t *src = image.GetPixels() + (yy - y) * image.GetWidth() + (area.x - x);
+        BlendKernels::BlitSpan(canvas + yy * SCREEN_WIDTH + area.x, src, area.w);
+    }
+    canvasDamage.Add(area);
+}
 
-    if (dataPos == 0) {
-        dataPos = 54;
+void DrawUtils::drawBitmap(uint32_t x, uint32_t y, uint32_t target_width, uint32_t target_height, const uint8_t *data, uint32_t size) {
+    auto image = ImageSurface::LoadBMP(data, size, target_width, target_height);
+    if (image) {
+        drawImage(x, y, **image);
     }
+}
 
-    data += dataPos;
+void DrawUtils::drawPNG(uint32_t x, uint32_t y, const uint8_t *data, uint32_t size) {
+    auto image = ImageSurface::LoadPNG(data, size);
+    if (image) {
+        drawImage(x, y, **image);
+    }
+}
 
-    // TODO flip image since bitmaps are stored upside down
+static void reset_text_caches() {
+    std::fill(std::begin(fastGlyphs), std::end(fastGlyphs), FAST_GLYPH_UNKNOWN);
+    for (auto &cache : advanceCaches) {
+        cache.size = 0;
+    }
+    currentAdvances = nullptr;
+    for (auto &memo : textWidthMemo) {
+        memo.size = 0;
+    }
+}
 
-    for (uint32_t yy = y; yy < y + target_height; yy++) {
-        for (uint32_t xx = x; xx < x + target_width; xx++) {
-            uint32_t i = (((xx - x) * width / target_width) + ((yy - y) * height / target_height) * width) * 3;
-            drawPixel(xx, yy, data[i + 2], data[i + 1], data[i], 0xFF);
+static void select_advance_cache(uint32_t size) {
+    for (auto &cache : advanceCaches) {
+        if (cache.size == size) {
+            currentAdvances = &cache;
+            return;
         }
     }
+    currentAdvances       = &advanceCaches[nextAdvanceCache];
+    nextAdvanceCache      = (nextAdvanceCache + 1) % ADVANCE_CACHE_SIZES;
+    currentAdvances->size = size;
+    std::fill(std::begin(currentAdvances->advance), std::end(currentAdvances->advance), -1);
 }
 
-static void png_read_data(png_structp png_ptr, png_bytep outBytes, png_size_t byteCountToRead) {
-    void **data = (void **) png_get_io_ptr(png_ptr);
-
-    memcpy(outBytes, *data, byteCountToRead);
-    *((uint8_t **) data) += byteCountToRead;
+static int32_t fast_glyph_index(uint32_t codepoint) {
+    if (codepoint - ASCII_GLYPH_FIRST < ASCII_GLYPH_COUNT) {
+        return (int32_t) (codepoint - ASCII_GLYPH_FIRST);
+    }
+    if (codepoint - PUA_GLYPH_FIRST < PUA_GLYPH_COUNT) {
+        return (int32_t) (ASCII_GLYPH_COUNT + codepoint - PUA_GLYPH_FIRST);
+    }
+    return -1;
 }
 
-void DrawUtils::drawPNG(uint32_t x, uint32_t y, const uint8_t *data) {
-    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-    if (png_ptr == nullptr) {
-        return;
+static bool lookup_glyph(uint32_t codepoint, SFT_Glyph *gid) {
+    int32_t index = fast_glyph_index(codepoint);
+    if (index < 0) {
+        return sft_lookup(&pFont, codepoint, gid) >= 0;
     }
-
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (info_ptr == nullptr) {
-        png_destroy_read_struct(&png_ptr, nullptr, nullptr);
-        return;
+    if (fastGlyphs[index] == FAST_GLYPH_UNKNOWN) {
+        SFT_Glyph glyph;
+        fastGlyphs[index] = sft_lookup(&pFont, codepoint, &glyph) >= 0 ? (uint32_t) glyph : FAST_GLYPH_MISSING;
     }
-
-    png_set_read_fn(png_ptr, (void *) &data, png_read_data);
-
-    png_read_info(png_ptr, info_ptr);
-
-    uint32_t width  = 0;
-    uint32_t height = 0;
-    int bitDepth    = 0;
-    int colorType   = -1;
-    uint32_t retval = png_get_IHDR(png_ptr, info_ptr, &width, &height, &bitDepth, &colorType, nullptr, nullptr, nullptr);
-    if (retval != 1) {
-        return;
+    if (fastGlyphs[index] == FAST_GLYPH_MISSING) {
+        return false;
     }
+    *gid = fastGlyphs[index];
+    return true;
+}
 
-    uint32_t bytesPerRow = png_get_rowbytes(png_ptr, info_ptr);
-    auto *rowData        = new uint8_t[bytesPerRow];
-
-    for (uint32_t yy = y; yy < y + height; yy++) {
-        png_read_row(png_ptr, (png_bytep) rowData, nullptr);
+static bool get_advance(uint32_t codepoint, int32_t *advance) {
+    int32_t index = fast_glyph_index(codepoint);
+    if (index >= 0 && currentAdvances && currentAdvances->advance[index] >= 0) {
+        *advance = currentAdvances->advance[index];
+        return true;
+    }
 
-        for (uint32_t xx = x; xx < x + width; xx++) {
-            if (colorType == PNG_COLOR_TYPE_RGB_ALPHA) {
-                uint32_t i = (xx - x) * 4;
-                drawPixel(xx, yy, rowData[i], rowData[i + 1], rowData[i + 2], rowData[i + 3]);
-            } else if (colorType == PNG_COLOR_TYPE_RGB) {
-                uint32_t i = (xx - x) * 3;
-                drawPixel(xx, yy, rowData[i], rowData[i + 1], rowData[i + 2], 0xFF);
-            }
-        }
+    SFT_Glyph gid;
+    if (!lookup_glyph(codepoint, &gid)) {
+        return false;
     }
+    SFT_GMetrics mtx;
+    if (sft_gmetrics(&pFont, gid, &mtx) < 0) {
+        DEBUG_FUNCTION_LINE_ERR("bad glyph metrics");
+        return false;
+    }
+    *advance = (int32_t) mtx.advanceWidth;
+    if (index >= 0 && currentAdvances) {
+        currentAdvances->advance[index] = (int16_t) *advance;
+    }
+    return true;
+}
 
-    delete[] rowData;
-    png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+static uint32_t hash_text(const char *text, uint32_t length) {
+    // FNV-1a
+    uint32_t hash = 0x811C9DC5;
+    for (uint32_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t) text[i]) * 0x01000193;
+    }
+    return hash;
 }
 
 bool DrawUtils::initFont() {
@@ -215,6 +409,10 @@ bool DrawUtils::initFont() {
         if (!pFont.font) {
             return false;
         }
+        glyphCache   = make_unique_nothrow<GlyphCache>(GLYPH_CACHE_SIZE);
+        glyphScratch = make_unique_nothrow<uint8_t[]>(GLYPH_SCRATCH_SIZE);
+        reset_text_caches();
+        select_advance_cache((uint32_t) pFont.xScale);
         OSMemoryBarrier();
         return true;
     }
@@ -222,6 +420,10 @@ bool DrawUtils::initFont() {
 }
 
 void DrawUtils::deinitFont() {
+    finishPrerender();
+    glyphCache.reset();
+    glyphScratch.reset();
+    reset_text_caches();
     sft_freefont(pFont.font);
     pFont.font = nullptr;
     pFont      = {};
@@ -232,136 +434,304 @@ void DrawUtils::setFontSize(uint32_t size) {
     pFont.yScale = size;
     SFT_LMetrics metrics;
     sft_lmetrics(&pFont, &metrics);
+    select_advance_cache(size);
 }
 
 void DrawUtils::setFontColor(Color col) {
     font_col = col;
 }
 
-static void draw_freetype_bitmap(SFT_Image *bmp, int32_t x, int32_t y) {
-    int32_t i, j, p, q;
-
-    int32_t x_max = x + bmp->width;
-    int32_t y_max = y + bmp->height;
+// Runs on a worker core, only touches the glyphs of this worker and its own scratch memory.
+// Without worker cores it runs on the main core and uses the scratch memory of the glyph cache instead.
+static void prerender_glyphs(uint32_t worker) {
+    SFT font      = prerenderFont;
+    auto *scratch = CoreThread::GetWorkerCount() > 0 ? prerenderScratch[worker].get() : glyphScratch.get();
+    for (uint32_t i = worker; i < prerenderGlyphs.size(); i += PRERENDER_WORKERS) {
+        auto &glyph = prerenderGlyphs[i];
+        if (glyph.width == 0 || glyph.height == 0) {
+            glyph.rendered = true;
+            continue;
+        }
+        font.xScale   = glyph.size;
+        font.yScale   = glyph.size;
+        SFT_Image img = {
+                .pixels = prerenderPixels.get() + glyph.offset,
+                .width  = glyph.width,
+                .height = glyph.height,
+        };
+        glyph.rendered = (scratch && sft_render_fixed(&font, glyph.glyph, img, scratch, GLYPH_SCRATCH_SIZE) == 0) ||
+                         sft_render(&font, glyph.glyph, img) == 0;
+    }
+}
 
-    auto *src = (uint8_t *) bmp->pixels;
+void DrawUtils::startPrerender(const std::vector<TextRun> &texts) {
+    finishPrerender();
+    if (!pFont.font || !glyphCache) {
+        return;
+    }
 
-    for (i = x, p = 0; i < x_max; i++, p++) {
-        for (j = y, q = 0; j < y_max; j++, q++) {
-            if (i < 0 || j < 0 || i >= SCREEN_WIDTH || j >= SCREEN_HEIGHT) {
+    prerenderFont = pFont;
+    SFT font      = pFont;
+    std::unordered_set<uint32_t> seen;
+    uint32_t totalBytes = 0;
+    for (auto const &text : texts) {
+        font.xScale = text.size;
+        font.yScale = text.size;
+        Utf8Decoder decoder(text.text);
+        uint32_t codepoint;
+        while (decoder.Next(codepoint)) {
+            SFT_Glyph gid;
+            if (!lookup_glyph(codepoint, &gid) || !seen.insert((gid << 10) | (text.size & 0x3FF)).second || glyphCache->Get(gid, text.size)) {
+                continue;
+            }
+            SFT_GMetrics mtx;
+            if (sft_gmetrics(&font, gid, &mtx) < 0) {
+                continue;
+            }
+            auto width  = (uint16_t) ((mtx.minWidth + 3) & ~3);
+            auto height = (uint16_t) mtx.minHeight;
+            auto bytes  = (uint32_t) width * height;
+            // Glyphs that won't fit into the cache anyway aren't worth rendering
+            if (totalBytes + bytes > GLYPH_CACHE_SIZE) {
                 continue;
             }
+            prerenderGlyphs.push_back({gid, text.size, mtx, totalBytes, width, height, false});
+            totalBytes += bytes;
+        }
+    }
+    if (prerenderGlyphs.empty()) {
+        return;
+    }
+
+    prerenderPixels = make_unique_nothrow<uint8_t[]>(totalBytes > 0 ? totalBytes : 1);
+    if (!prerenderPixels) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to allocate memory to prerender glyphs");
+        prerenderGlyphs.clear();
+        return;
+    }
+
+    // Without worker cores the whole set is rendered right here, before the first frame instead of glyph by glyph while drawing it.
+    if (CoreThread::GetWorkerCount() == 0) {
+        for (uint32_t i = 0; i < PRERENDER_WORKERS; i++) {
+            prerender_glyphs(i);
+        }
+        DEBUG_FUNCTION_LINE_VERBOSE("Prerendered %d glyphs (%d bytes) on the main core", prerenderGlyphs.size(), totalBytes);
+        return;
+    }
 
-            float opacity = src[q * bmp->width + p] / 255.0f;
-            DrawUtils::drawPixel(i, j, font_col.r, font_col.g, font_col.b, font_col.a * opacity);
+    for (uint32_t i = 0; i < PRERENDER_WORKERS; i++) {
+        prerenderScratch[i] = make_unique_nothrow<uint8_t[]>(GLYPH_SCRATCH_SIZE);
+        if (!prerenderThreads[i].Start([i]() { prerender_glyphs(i); }, CoreThread::GetWorkerAffinity(i), "EnvironmentLoader Glyphs")) {
+            prerender_glyphs(i);
         }
     }
+    DEBUG_FUNCTION_LINE_VERBOSE("Prerender %d glyphs (%d bytes)", prerenderGlyphs.size(), totalBytes);
 }
 
-void DrawUtils::print(uint32_t x, uint32_t y, const char *string, bool alignRight) {
-    auto *buffer = new wchar_t[strlen(string) + 1];
+void DrawUtils::finishPrerender() {
+    for (auto &thread : prerenderThreads) {
+        thread.Join();
+    }
 
-    size_t num = mbstowcs(buffer, string, strlen(string));
-    if (num > 0) {
-        buffer[num] = 0;
-    } else {
-        wchar_t *tmp = buffer;
-        while ((*tmp++ = *string++))
-            ;
+    for (auto const &glyph : prerenderGlyphs) {
+        if (!glyph.rendered || !glyphCache) {
+            continue;
+        }
+        CachedGlyph *cached = glyphCache->Reserve(glyph.glyph, glyph.size, glyph.width, glyph.height);
+        if (!cached) {
+            continue;
+        }
+        cached->metrics = glyph.metrics;
+        memcpy(cached->coverage, prerenderPixels.get() + glyph.offset, (uint32_t) glyph.width * glyph.height);
     }
 
-    print(x, y, buffer, alignRight);
-    delete[] buffer;
+    prerenderGlyphs = {};
+    prerenderPixels.reset();
+    for (auto &scratch : prerenderScratch) {
+        scratch.reset();
+    }
 }
 
-void DrawUtils::print(uint32_t x, uint32_t y, const wchar_t *string, bool alignRight) {
-    auto penX = (int32_t) x;
-    auto penY = (int32_t) y;
+// Blends one row of coverage values with the font color
+static void draw_coverage_span(int32_t x, int32_t y, const uint8_t *coverage, int32_t count) {
+    if (y < clipY0 || y >= clipY1) {
+        return;
+    }
+    if (x < clipX0) {
+        coverage += clipX0 - x;
+        count -= clipX0 - x;
+        x = clipX0;
+    }
+    if (x + count > clipX1) {
+        count = clipX1 - x;
+    }
+    if (count <= 0) {
+        return;
+    }
 
-    if (alignRight) {
-        penX -= getTextWidth(string);
+    BlendKernels::BlendCoverageSpan(canvas + y * SCREEN_WIDTH + x, coverage, count, font_col.color, font_col.a);
+}
+
+// Returns the rendered glyph from the cache, rasterizes it on a miss.
+// Glyphs that don't fit into the cache are rendered into fallback.
+static const CachedGlyph *get_glyph(SFT_Glyph gid, CachedGlyph &fallback, std::unique_ptr<uint8_t[]> &fallbackBuffer) {
+    auto size = (uint32_t) pFont.xScale;
+    if (glyphCache) {
+        if (auto *cached = glyphCache->Get(gid, size)) {
+            return cached;
+        }
+    }
+
+    SFT_GMetrics mtx;
+    if (sft_gmetrics(&pFont, gid, &mtx) < 0) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to get glyph metrics");
+        return nullptr;
+    }
+
+    auto width  = (uint16_t) ((mtx.minWidth + 3) & ~3);
+    auto height = (uint16_t) mtx.minHeight;
+
+    CachedGlyph *glyph = glyphCache ? glyphCache->Reserve(gid, size, width, height) : nullptr;
+    if (!glyph) {
+        fallbackBuffer = make_unique_nothrow<uint8_t[]>((uint32_t) (width * height));
+        if (!fallbackBuffer) {
+            DEBUG_FUNCTION_LINE_ERR("Failed to allocate memory for glyph");
+            return nullptr;
+        }
+        fallback          = {};
+        fallback.coverage = fallbackBuffer.get();
+        fallback.width    = width;
+        fallback.height   = height;
+        glyph             = &fallback;
+    }
+    glyph->metrics = mtx;
+
+    if (width != 0 && height != 0) {
+        SFT_Image img = {
+                .pixels = glyph->coverage,
+                .width  = width,
+                .height = height,
+        };
+        bool rendered = glyphScratch && sft_render_fixed(&pFont, gid, img, glyphScratch.get(), GLYPH_SCRATCH_SIZE) == 0;
+        if (!rendered && sft_render(&pFont, gid, img) < 0) {
+            DEBUG_FUNCTION_LINE_ERR("Failed to render glyph");
+            if (glyph != &fallback) {
+                glyphCache->Remove(gid, size);
+            }
+            return nullptr;
+        }
     }
+    return glyph;
+}
+
+// Yields the characters of a wide string, same interface as Utf8Decoder
+struct WideDecoder {
+    const wchar_t *string;
 
-    uint16_t textureWidth = 0, textureHeight = 0;
-    for (; *string; string++) {
+    bool Next(uint32_t &codepoint) {
+        if (!*string) {
+            return false;
+        }
+        codepoint = (uint32_t) *string++;
+        return true;
+    }
+};
+
+template<typename Decoder>
+static void print_text(int32_t x, int32_t y, Decoder decoder) {
+    auto penX = x;
+    auto penY = y;
+
+    CachedGlyph fallback;
+    std::unique_ptr<uint8_t[]> fallbackBuffer;
+    uint32_t codepoint;
+    while (decoder.Next(codepoint)) {
         SFT_Glyph gid; //  unsigned long gid;
-        if (sft_lookup(&pFont, *string, &gid) >= 0) {
-            SFT_GMetrics mtx;
-            if (sft_gmetrics(&pFont, gid, &mtx) < 0) {
-                DEBUG_FUNCTION_LINE_ERR("Failed to get glyph metrics");
+        if (lookup_glyph(codepoint, &gid)) {
+            const CachedGlyph *glyph = get_glyph(gid, fallback, fallbackBuffer);
+            if (!glyph) {
                 return;
             }
 
-            if (*string == '\n') {
-                penY += mtx.minHeight;
+            if (codepoint == '\n') {
+                penY += glyph->metrics.minHeight;
                 penX = x;
                 continue;
             }
 
-            textureWidth  = (mtx.minWidth + 3) & ~3;
-            textureHeight = mtx.minHeight;
-
-            SFT_Image img = {
-                    .pixels = nullptr,
-                    .width  = textureWidth,
-                    .height = textureHeight,
-            };
-
-            if (textureWidth == 0) {
-                textureWidth = 4;
-            }
-            if (textureHeight == 0) {
-                textureHeight = 4;
+            auto glyphX = (int32_t) (penX + glyph->metrics.leftSideBearing);
+            auto glyphY = (int32_t) (penY + glyph->metrics.yOffset);
+            for (uint32_t j = 0; j < glyph->height; j++) {
+                draw_coverage_span(glyphX, glyphY + (int32_t) j, glyph->coverage + j * glyph->width, glyph->width);
             }
+            canvasDamage.Add(Rect{glyphX, glyphY, glyph->width, glyph->height}.Intersection({clipX0, clipY0, clipX1 - clipX0, clipY1 - clipY0}));
+            penX += (int32_t) glyph->metrics.advanceWidth;
+        }
+    }
+}
 
-            auto buffer = make_unique_nothrow<uint8_t[]>((uint32_t) (img.width * img.height));
-            if (!buffer) {
-                DEBUG_FUNCTION_LINE_ERR("Failed to allocate memory for glyph");
-                return;
-            }
-            img.pixels = buffer.get();
-            if (sft_render(&pFont, gid, img) < 0) {
-                DEBUG_FUNCTION_LINE_ERR("Failed to render glyph");
-                return;
-            } else {
-                draw_freetype_bitmap(&img, (int32_t) (penX + mtx.leftSideBearing), (int32_t) (penY + mtx.yOffset));
-                penX += (int32_t) mtx.advanceWidth;
-            }
+template<typename Decoder>
+static uint32_t text_width(Decoder decoder) {
+    int32_t width = 0;
+    uint32_t codepoint;
+    while (decoder.Next(codepoint)) {
+        int32_t advance;
+        if (get_advance(codepoint, &advance)) {
+            width += advance;
         }
     }
+    return (uint32_t) width;
 }
 
-uint32_t DrawUtils::getTextWidth(const char *string) {
-    auto *buffer = new wchar_t[strlen(string) + 1];
+void DrawUtils::print(uint32_t x, uint32_t y, const char *string, bool alignRight) {
+    print(x, y, std::string_view(string), alignRight);
+}
 
-    size_t num = mbstowcs(buffer, string, strlen(string));
-    if (num > 0) {
-        buffer[num] = 0;
-    } else {
-        wchar_t *tmp = buffer;
-        while ((*tmp++ = *string++))
-            ;
+void DrawUtils::print(uint32_t x, uint32_t y, std::string_view string, bool alignRight) {
+    if (alignRight) {
+        x -= getTextWidth(string);
     }
+    print_text((int32_t) x, (int32_t) y, Utf8Decoder(string));
+}
 
-    uint32_t width = getTextWidth(buffer);
-    delete[] buffer;
-
-    return width;
+void DrawUtils::print(uint32_t x, uint32_t y, const wchar_t *string, bool alignRight) {
+    if (alignRight) {
+        x -= getTextWidth(string);
+    }
+    print_text((int32_t) x, (int32_t) y, WideDecoder{string});
 }
 
-uint32_t DrawUtils::getTextWidth(const wchar_t *string) {
-    uint32_t width = 0;
+uint32_t DrawUtils::getTextWidth(const char *string) {
+    return getTextWidth(std::string_view(string));
+}
 
-    for (; *string; string++) {
-        SFT_Glyph gid; //  unsigned long gid;
-        if (sft_lookup(&pFont, *string, &gid) >= 0) {
-            SFT_GMetrics mtx;
-            if (sft_gmetrics(&pFont, gid, &mtx) < 0) {
-                DEBUG_FUNCTION_LINE_ERR("bad glyph metrics");
+uint32_t DrawUtils::getTextWidth(std::string_view string) {
+    auto size     = (uint32_t) pFont.xScale;
+    auto length   = (uint32_t) string.size();
+    uint32_t hash = hash_text(string.data(), length);
+    if (length < TEXT_WIDTH_MEMO_MAX_LENGTH) {
+        for (auto &memo : textWidthMemo) {
+            if (memo.size == size && memo.hash == hash && memo.length == length && memcmp(memo.text, string.data(), length) == 0) {
+                return memo.width;
             }
-            width += (int32_t) mtx.advanceWidth;
         }
     }
 
-    return (uint32_t) width;
+    uint32_t width = text_width(Utf8Decoder(string));
+
+    if (length < TEXT_WIDTH_MEMO_MAX_LENGTH) {
+        auto &memo        = textWidthMemo[nextTextWidthMemo];
+        nextTextWidthMemo = (nextTextWidthMemo + 1) % TEXT_WIDTH_MEMO_SIZE;
+        memo.hash         = hash;
+        memo.size         = size;
+        memo.width        = width;
+        memo.length       = length;
+        memcpy(memo.text, string.data(), length);
+    }
+
+    return width;
+}
+
+uint32_t DrawUtils::getTextWidth(const wchar_t *string) {
+    return text_width(WideDecoder{string});
 }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "ImageSurface.h"
 #include "schrift.h"
+#include <algorithm>
 #include <cstdint>
+#include <string_view>
+#include <vector>
 
 #define COLOR_WHITE              Color(0xffffffff)
 #define COLOR_BLACK              Color(0, 0, 0, 255)
@@ -12,6 +16,7 @@
 #define COLOR_AUTOBOOT           Color(0xaeea00ff)
 #define COLOR_BORDER             Color(204, 204, 204, 255)
 #define COLOR_BORDER_HIGHLIGHTED Color(0x3478e4ff)
+#define COLOR_ICON_PLACEHOLDER   Color(0x1a4680ff)
 
 // visible screen sizes
 #define SCREEN_WIDTH             854
@@ -38,9 +43,57 @@ union Color {
     };
 };
 
+struct Rect {
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t w = 0;
+    int32_t h = 0;
+
+    [[nodiscard]] bool IsEmpty() const {
+        return w <= 0 || h <= 0;
+    }
+
+    [[nodiscard]] bool Intersects(const Rect &other) const {
+        return x < other.x + other.w && other.x < x + w && y < other.y + other.h && other.y < y + h;
+    }
+
+    [[nodiscard]] Rect Intersection(const Rect &other) const {
+        int32_t x0 = std::max(x, other.x);
+        int32_t y0 = std::max(y, other.y);
+        int32_t x1 = std::min(x + w, other.x + other.w);
+        int32_t y1 = std::min(y + h, other.y + other.h);
+        if (x0 >= x1 || y0 >= y1) {
+            return {};
+        }
+        return {x0, y0, x1 - x0, y1 - y0};
+    }
+
+    [[nodiscard]] Rect Union(const Rect &other) const {
+        if (IsEmpty()) {
+            return other;
+        }
+        if (other.IsEmpty()) {
+            return *this;
+        }
+        int32_t x0 = std::min(x, other.x);
+        int32_t y0 = std::min(y, other.y);
+        return {x0, y0, std::max(x + w, other.x + other.w) - x0, std::max(y + h, other.y + other.h) - y0};
+    }
+};
+
+// A text and the font size it will be printed with
+struct TextRun {
+    const char *text;
+    uint32_t size;
+};
+
 class DrawUtils {
 public:
-    static void initBuffers(void *tvBuffer, uint32_t tvSize, void *drcBuffer, uint32_t drcSize);
+    //! Everything is drawn into an offscreen canvas at DRC resolution. endDraw copies the parts that have changed
+    //! to the DRC buffer and scales them into the TV buffer.
+    static bool initBuffers(void *tvBuffer, uint32_t tvSize, void *drcBuffer, uint32_t drcSize);
+
+    static void deinitBuffers();
 
     static void beginDraw();
 
@@ -48,6 +101,15 @@ public:
 
     static void clear(Color col);
 
+    //! Restricts all drawing to rect until resetClipRect is called.
+    static void setClipRect(const Rect &rect);
+
+    static void resetClipRect();
+
+    //! Marks rect as changed so endDraw presents it. Only needed after drawPixel, everything else adds its own damage.
+    static void addDamage(const Rect &rect);
+
+    //! Writes a single pixel to the canvas without adding damage. Callers add one rect for the whole primitive via addDamage.
     static void drawPixel(uint32_t x, uint32_t y, Color col) { drawPixel(x, y, col.r, col.g, col.b, col.a); }
 
     static void drawPixel(uint32_t x, uint32_t y, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
@@ -56,9 +118,12 @@ public:
 
     static void drawRect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t borderSize, Color col);
 
-    static void drawBitmap(uint32_t x, uint32_t y, uint32_t target_width, uint32_t target_height, const uint8_t *data);
+    static void drawImage(uint32_t x, uint32_t y, const ImageSurface &image);
 
-    static void drawPNG(uint32_t x, uint32_t y, const uint8_t *data);
+    //! Decodes the image on every call, prefer ImageSurface and drawImage for anything that is drawn more than once.
+    static void drawBitmap(uint32_t x, uint32_t y, uint32_t target_width, uint32_t target_height, const uint8_t *data, uint32_t size);
+
+    static void drawPNG(uint32_t x, uint32_t y, const uint8_t *data, uint32_t size);
 
     static bool initFont();
 
@@ -68,12 +133,25 @@ public:
 
     static void setFontColor(Color col);
 
+    //! Renders the glyphs of all texts on the worker cores. They are added to the glyph cache by finishPrerender.
+    //! If worker cores are disabled the glyphs are rendered on the calling core before returning.
+    //! Texts earlier in the list are preferred if not all glyphs fit into the cache.
+    static void startPrerender(const std::vector<TextRun> &texts);
+
+    //! Waits for the glyphs of startPrerender and moves them into the glyph cache.
+    static void finishPrerender();
+
     static void print(uint32_t x, uint32_t y, const char *string, bool alignRight = false);
 
+    //! string is UTF-8 and doesn't need to be null-terminated.
+    static void print(uint32_t x, uint32_t y, std::string_view string, bool alignRight = false);
+
     static void print(uint32_t x, uint32_t y, const wchar_t *string, bool alignRight = false);
 
     static uint32_t getTextWidth(const char *string);
 
+    static uint32_t getTextWidth(std::string_view string);
+
     static uint32_t getTextWidth(const wchar_t *string);
 
 private:
@@ -0,0 +1,69 @@
+#include "FilePrefetcher.h"
+#include "FileUtils.h"
+#include "logger.h"
+#include <coreinit/time.h>
+#include <cstdlib>
+
+FilePrefetcher::~FilePrefetcher() {
+    Wait();
+    Discard();
+}
+
+void FilePrefetcher::Start(const std::string &path) {
+    if (!mEnabled || !mPath.empty()) {
+        return;
+    }
+
+    mPath         = path;
+    auto prefetch = [this]() {
+        OSTime start = OSGetTime();
+        mResult      = LoadFileToMem(mPath.c_str(), &mBuffer, &mSize);
+        mReadTicks   = OSGetTime() - start;
+        DEBUG_FUNCTION_LINE_TRACE("Prefetched %s (%d bytes) in %lld us", mPath.c_str(), mSize, OSTicksToMicroseconds(mReadTicks));
+    };
+    if (!mThread.Start(std::move(prefetch), CoreThread::GetWorkerAffinity(0), "EnvironmentLoader Prefetch")) {
+        mPath.clear();
+    }
+}
+
+void FilePrefetcher::Wait() {
+    mThread.Join();
+}
+
+int32_t FilePrefetcher::Take(const std::string &path, uint8_t **buffer, uint32_t *size, OSTime *readTicks, bool *prefetched) {
+    Wait();
+    if (mPath == path && mResult >= 0) {
+        *buffer = mBuffer;
+        *size   = mSize;
+        mBuffer = nullptr;
+        mSize   = 0;
+        mPath.clear();
+        if (readTicks) {
+            *readTicks = mReadTicks;
+        }
+        if (prefetched) {
+            *prefetched = true;
+        }
+        return mResult;
+    }
+
+    Discard();
+    OSTime start = OSGetTime();
+    auto result  = LoadFileToMem(path.c_str(), buffer, size);
+    if (readTicks) {
+        *readTicks = OSGetTime() - start;
+    }
+    if (prefetched) {
+        *prefetched = false;
+    }
+    return result;
+}
+
+void FilePrefetcher::Discard() {
+    free(mBuffer);
+    mBuffer = nullptr;
+    mSize   = 0;
+    mResult    = -1;
+    mReadTicks = 0;
+    mPath.clear();
+}
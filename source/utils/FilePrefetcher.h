@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreThread.h"
+#include <coreinit/time.h>
+#include <cstdint>
+#include <string>
+
+/**
+ * Loads a single file into memory on a worker core so the read overlaps with work on the main core.
+ * The buffer is allocated when the read starts and stays allocated until Take() hands it over or the prefetcher is destroyed.
+ * Without worker cores (see CoreThread) Take() simply reads the file.
+ */
+class FilePrefetcher {
+public:
+    explicit FilePrefetcher(bool enabled) : mEnabled(enabled) {
+    }
+
+    ~FilePrefetcher();
+
+    FilePrefetcher(const FilePrefetcher &) = delete;
+    FilePrefetcher &operator=(const FilePrefetcher &) = delete;
+
+    //! Starts loading path in the background. Does nothing if prefetching is disabled or another file is still pending.
+    void Start(const std::string &path);
+
+    //! Waits until the pending read has finished.
+    void Wait();
+
+    //! Same as LoadFileToMem, but takes the prefetched buffer if it matches the path.
+    //! readTicks receives how long the read itself took, prefetched whether it happened in the background.
+    int32_t Take(const std::string &path, uint8_t **buffer, uint32_t *size, OSTime *readTicks = nullptr, bool *prefetched = nullptr);
+
+private:
+    void Discard();
+
+    bool mEnabled;
+    CoreThread mThread;
+    std::string mPath;
+    uint8_t *mBuffer  = nullptr;
+    uint32_t mSize    = 0;
+    int32_t mResult   = -1;
+    OSTime mReadTicks = 0;
+};
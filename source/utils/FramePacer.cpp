@@ -0,0 +1,48 @@
+#include "FramePacer.h"
+#include "logger.h"
+#include <coreinit/thread.h>
+
+#define STATS_INTERVAL_SECONDS 5
+
+FramePacer::FramePacer() {
+    mFrameStart   = OSGetTime();
+    mNextDeadline = mFrameStart;
+    mStatsStart   = mFrameStart;
+}
+
+void FramePacer::EndFrame(bool drawn) {
+    OSTime now = OSGetTime();
+    mBusyTicks += now - mFrameStart;
+    mIterations++;
+    if (drawn) {
+        mDrawnFrames++;
+        mIdleFrames = 0;
+    } else if (mIdleFrames < IDLE_AFTER_FRAMES) {
+        mIdleFrames++;
+    }
+
+    uint32_t frames = mIdleFrames >= IDLE_AFTER_FRAMES ? IDLE_FRAME_INTERVAL : 1;
+    mNextDeadline += OSMicrosecondsToTicks(FRAME_INTERVAL_US) * frames;
+    if (mNextDeadline <= now) {
+        // We are late, don't try to catch up.
+        mNextDeadline = now;
+    } else {
+        OSSleepTicks(mNextDeadline - now);
+    }
+
+    mFrameStart = OSGetTime();
+    if (mFrameStart - mStatsStart >= OSSecondsToTicks(STATS_INTERVAL_SECONDS)) {
+        LogStats(mFrameStart);
+    }
+}
+
+void FramePacer::LogStats(OSTime now) {
+    DEBUG_FUNCTION_LINE("Menu: %d iterations, %d frames drawn in %d ms, busy %d us per iteration (%d%%)",
+                        mIterations, mDrawnFrames, (uint32_t) OSTicksToMilliseconds(now - mStatsStart),
+                        mIterations ? (uint32_t) OSTicksToMicroseconds(mBusyTicks / mIterations) : 0,
+                        (uint32_t) (mBusyTicks * 100 / (now - mStatsStart)));
+    mStatsStart  = now;
+    mBusyTicks   = 0;
+    mIterations  = 0;
+    mDrawnFrames = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <coreinit/time.h>
+#include <cstdint>
+
+/**
+ * Paces a menu loop to the display refresh rate of ~60Hz.
+ * OSScreen has no way to wait for a vsync, so the loop sleeps until the next frame deadline instead.
+ * After a while without any redraws input is only polled every IDLE_FRAME_INTERVAL frames.
+ * The frame rate and the time spent outside of the sleep are logged periodically.
+ */
+class FramePacer {
+public:
+    static constexpr uint32_t FRAME_INTERVAL_US   = 16667;
+    static constexpr uint32_t IDLE_AFTER_FRAMES   = 60;
+    static constexpr uint32_t IDLE_FRAME_INTERVAL = 2;
+
+    FramePacer();
+
+    //! Call at the end of each loop iteration. Sleeps until the next frame should start.
+    void EndFrame(bool drawn);
+
+private:
+    void LogStats(OSTime now);
+
+    OSTime mFrameStart    = 0;
+    OSTime mNextDeadline  = 0;
+    uint32_t mIdleFrames  = 0;
+    OSTime mStatsStart    = 0;
+    OSTime mBusyTicks     = 0;
+    uint32_t mIterations  = 0;
+    uint32_t mDrawnFrames = 0;
+};
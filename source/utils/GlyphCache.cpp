@@ -0,0 +1,98 @@
+#include "GlyphCache.h"
+#include "logger.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+GlyphCache::GlyphCache(uint32_t budget) {
+    mArena = make_unique_nothrow<uint8_t[]>(budget);
+    if (!mArena) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to allocate glyph cache, glyphs won't be cached");
+        return;
+    }
+    mBudget = budget;
+}
+
+const CachedGlyph *GlyphCache::Get(uint32_t glyph, uint32_t size) {
+    auto it = mGlyphs.find(MakeKey(glyph, size));
+    if (it == mGlyphs.end()) {
+        return nullptr;
+    }
+    it->second.lastUse = ++mUseCount;
+    return &it->second;
+}
+
+CachedGlyph *GlyphCache::Reserve(uint32_t glyph, uint32_t size, uint16_t width, uint16_t height) {
+    uint32_t bytes = ROUNDUP((uint32_t) width * height, 4);
+    if (bytes > mBudget) {
+        return nullptr;
+    }
+    Remove(glyph, size);
+
+    if (mUsed + bytes > mBudget) {
+        while (mLiveBytes + bytes > mBudget) {
+            EvictLeastRecentlyUsed();
+        }
+        Compact();
+    }
+
+    auto &entry    = mGlyphs[MakeKey(glyph, size)];
+    entry          = {};
+    entry.coverage = mArena.get() + mUsed;
+    entry.width    = width;
+    entry.height   = height;
+    entry.offset   = mUsed;
+    entry.lastUse  = ++mUseCount;
+
+    mUsed += bytes;
+    mLiveBytes += bytes;
+    return &entry;
+}
+
+void GlyphCache::Remove(uint32_t glyph, uint32_t size) {
+    auto it = mGlyphs.find(MakeKey(glyph, size));
+    if (it == mGlyphs.end()) {
+        return;
+    }
+    mLiveBytes -= ROUNDUP((uint32_t) it->second.width * it->second.height, 4);
+    mGlyphs.erase(it);
+}
+
+void GlyphCache::Clear() {
+    mGlyphs.clear();
+    mUsed      = 0;
+    mLiveBytes = 0;
+}
+
+void GlyphCache::EvictLeastRecentlyUsed() {
+    auto oldest = std::min_element(mGlyphs.begin(), mGlyphs.end(), [](const auto &a, const auto &b) { return a.second.lastUse < b.second.lastUse; });
+    if (oldest == mGlyphs.end()) {
+        return;
+    }
+    mLiveBytes -= ROUNDUP((uint32_t) oldest->second.width * oldest->second.height, 4);
+    mGlyphs.erase(oldest);
+}
+
+void GlyphCache::Compact() {
+    std::vector<CachedGlyph *> entries;
+    entries.reserve(mGlyphs.size());
+    for (auto &[key, entry] : mGlyphs) {
+        entries.push_back(&entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const CachedGlyph *a, const CachedGlyph *b) { return a->offset < b->offset; });
+
+    // Moving each bitmap down in offset order never overwrites one we still need.
+    uint32_t offset = 0;
+    for (auto *entry : entries) {
+        uint32_t bytes = ROUNDUP((uint32_t) entry->width * entry->height, 4);
+        if (entry->offset != offset) {
+            memmove(mArena.get() + offset, mArena.get() + entry->offset, bytes);
+        }
+        entry->offset   = offset;
+        entry->coverage = mArena.get() + offset;
+        offset += bytes;
+    }
+    mUsed = offset;
+    DEBUG_FUNCTION_LINE_VERBOSE("Compacted glyph cache, %d glyphs use %d bytes", entries.size(), mUsed);
+}
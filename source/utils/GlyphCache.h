@@ -0,0 +1,57 @@
+#pragma once
+
+#include "schrift.h"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+struct CachedGlyph {
+    SFT_GMetrics metrics;
+    // Coverage bitmap with width * height bytes, points into the arena of the cache.
+    uint8_t *coverage;
+    uint16_t width;
+    uint16_t height;
+    uint32_t offset;
+    uint32_t lastUse;
+};
+
+/**
+ * Keeps rendered glyph coverage bitmaps and their metrics, keyed by glyph id and pixel size.
+ * All bitmaps live in one arena with a fixed size. When it's full the least recently used glyphs are evicted
+ * and the remaining ones are moved to the front of the arena.
+ *
+ * Pointers returned by Get and Reserve are only valid until the next call to Reserve.
+ */
+class GlyphCache {
+public:
+    explicit GlyphCache(uint32_t budget);
+
+    GlyphCache(const GlyphCache &) = delete;
+    GlyphCache &operator=(const GlyphCache &) = delete;
+
+    const CachedGlyph *Get(uint32_t glyph, uint32_t size);
+
+    //! Allocates space for a width * height bitmap. The caller has to fill the metrics and the coverage.
+    //! Returns nullptr if the bitmap doesn't fit into the arena at all.
+    CachedGlyph *Reserve(uint32_t glyph, uint32_t size, uint16_t width, uint16_t height);
+
+    void Remove(uint32_t glyph, uint32_t size);
+
+    void Clear();
+
+private:
+    static uint32_t MakeKey(uint32_t glyph, uint32_t size) {
+        return (glyph << 10) | (size & 0x3FF);
+    }
+
+    void EvictLeastRecentlyUsed();
+
+    void Compact();
+
+    std::unique_ptr<uint8_t[]> mArena;
+    uint32_t mBudget    = 0;
+    uint32_t mUsed      = 0;
+    uint32_t mLiveBytes = 0;
+    uint32_t mUseCount  = 0;
+    std::unordered_map<uint32_t, CachedGlyph> mGlyphs;
+};
@@ -0,0 +1,257 @@
+#include "ImageSurface.h"
+#include "logger.h"
+#include "utils.h"
+#include <algorithm>
+#include <csetjmp>
+#include <cstring>
+#include <png.h>
+
+namespace {
+    struct PNGReadState {
+        const uint8_t *data;
+        uint32_t remaining;
+    };
+
+    void PNGReadData(png_structp png_ptr, png_bytep outBytes, png_size_t byteCountToRead) {
+        auto *state = (PNGReadState *) png_get_io_ptr(png_ptr);
+        if (byteCountToRead > state->remaining) {
+            png_error(png_ptr, "Read past the end of the image");
+        }
+        memcpy(outBytes, state->data, byteCountToRead);
+        state->data += byteCountToRead;
+        state->remaining -= byteCountToRead;
+    }
+
+    inline uint32_t Premultiply(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+        if (a != 0xFF) {
+            r = (r * a + 127) / 255;
+            g = (g * a + 127) / 255;
+            b = (b * a + 127) / 255;
+        }
+        return (r << 24) | (g << 16) | (b << 8) | a;
+    }
+
+    inline uint32_t ReadLE32(const uint8_t *data) {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+    }
+
+    std::optional<std::unique_ptr<ImageSurface>> MakeSurface(uint32_t width, uint32_t height, std::unique_ptr<uint32_t[]> pixels) {
+        auto surface = make_unique_nothrow<ImageSurface>(width, height, std::move(pixels));
+        if (!surface) {
+            DEBUG_FUNCTION_LINE_ERR("Failed to allocate image surface");
+            return {};
+        }
+        return surface;
+    }
+
+    inline uint16_t ReadLE16(const uint8_t *data) {
+        return data[0] | (data[1] << 8);
+    }
+
+    // A color channel of a BI_BITFIELDS bitmap
+    struct BitfieldChannel {
+        uint32_t shift = 0;
+        uint32_t max   = 0;
+
+        explicit BitfieldChannel(uint32_t mask) {
+            if (mask == 0) {
+                return;
+            }
+            while (!(mask & 1)) {
+                mask >>= 1;
+                shift++;
+            }
+            max = mask;
+        }
+
+        // Returns the channel scaled to 0-255, or fallback if the mask was empty.
+        [[nodiscard]] uint8_t Get(uint32_t pixel, uint8_t fallback) const {
+            if (max == 0) {
+                return fallback;
+            }
+            return (uint8_t) (((uint64_t) ((pixel >> shift) & max) * 255 + max / 2) / max);
+        }
+    };
+} // namespace
+
+std::optional<std::unique_ptr<ImageSurface>> ImageSurface::ScaleIfNeeded(std::unique_ptr<ImageSurface> image, uint32_t targetWidth, uint32_t targetHeight) {
+    if (targetWidth == 0 || targetHeight == 0 || (targetWidth == image->mWidth && targetHeight == image->mHeight)) {
+        return image;
+    }
+    return image->Scale(targetWidth, targetHeight);
+}
+
+std::optional<std::unique_ptr<ImageSurface>> ImageSurface::LoadPNG(const uint8_t *data, uint32_t size, uint32_t targetWidth, uint32_t targetHeight) {
+    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (png_ptr == nullptr) {
+        return {};
+    }
+    png_infop info_ptr = png_create_info_struct(png_ptr);
+    if (info_ptr == nullptr) {
+        png_destroy_read_struct(&png_ptr, nullptr, nullptr);
+        return {};
+    }
+
+    // Everything libpng might jump over is allocated with malloc and freed manually.
+    uint8_t *volatile image  = nullptr;
+    png_bytep *volatile rows = nullptr;
+    PNGReadState state       = {data, size};
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to decode PNG");
+        free(image);
+        free(rows);
+        png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+        return {};
+    }
+
+    png_set_read_fn(png_ptr, &state, PNGReadData);
+    png_read_info(png_ptr, info_ptr);
+
+    // Convert everything to 8 bit RGBA
+    png_set_expand(png_ptr);
+    png_set_strip_16(png_ptr);
+    png_set_gray_to_rgb(png_ptr);
+    png_set_filler(png_ptr, 0xFF, PNG_FILLER_AFTER);
+    png_set_interlace_handling(png_ptr);
+    png_read_update_info(png_ptr, info_ptr);
+
+    uint32_t width  = png_get_image_width(png_ptr, info_ptr);
+    uint32_t height = png_get_image_height(png_ptr, info_ptr);
+    if (width == 0 || height == 0 || png_get_rowbytes(png_ptr, info_ptr) != width * 4 || width > 4096 || height > 4096) {
+        png_error(png_ptr, "Unsupported image size");
+    }
+
+    image = (uint8_t *) malloc(width * height * 4);
+    rows  = (png_bytep *) malloc(height * sizeof(png_bytep));
+    if (!image || !rows) {
+        png_error(png_ptr, "Not enough memory");
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        rows[y] = image + y * width * 4;
+    }
+    png_read_image(png_ptr, rows);
+    png_read_end(png_ptr, nullptr);
+    png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+    free(rows);
+
+    auto pixels = make_unique_nothrow<uint32_t[]>(width * height);
+    if (pixels) {
+        for (uint32_t i = 0; i < width * height; i++) {
+            const uint8_t *px = image + i * 4;
+            pixels[i]         = Premultiply(px[0], px[1], px[2], px[3]);
+        }
+    }
+    free(image);
+    if (!pixels) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to allocate image surface");
+        return {};
+    }
+
+    auto surface = MakeSurface(width, height, std::move(pixels));
+    if (!surface) {
+        return {};
+    }
+    return ScaleIfNeeded(std::move(*surface), targetWidth, targetHeight);
+}
+
+std::optional<std::unique_ptr<ImageSurface>> ImageSurface::LoadBMP(const uint8_t *data, uint32_t size, uint32_t targetWidth, uint32_t targetHeight) {
+    if (size < 54 || data[0] != 'B' || data[1] != 'M') {
+        // invalid header
+        return {};
+    }
+
+    uint32_t dataPos = ReadLE32(&data[0x0A]);
+    auto width       = (int32_t) ReadLE32(&data[0x12]);
+    auto height      = (int32_t) ReadLE32(&data[0x16]);
+    uint16_t bpp     = ReadLE16(&data[0x1C]);
+    uint32_t comp    = ReadLE32(&data[0x1E]);
+
+    if (dataPos == 0) {
+        dataPos = 54;
+    }
+    // Rows are stored bottom up unless the height is negative
+    bool bottomUp = height > 0;
+    if (height < 0) {
+        height = -height;
+    }
+    // BI_BITFIELDS is only supported for 32 bit pixels, the masks follow the 40 byte info header (or are part of a V4/V5 header)
+    if (width <= 0 || height == 0 || width > 4096 || height > 4096 || (bpp != 24 && bpp != 32) || (comp != 0 && (comp != 3 || bpp != 32 || size < 0x42))) {
+        DEBUG_FUNCTION_LINE_ERR("Unsupported BMP");
+        return {};
+    }
+    // Only V3 and newer info headers (at least 56 bytes) contain an alpha mask
+    uint32_t infoHeaderSize = ReadLE32(&data[0x0E]);
+    BitfieldChannel red(comp == 3 ? ReadLE32(&data[0x36]) : 0);
+    BitfieldChannel green(comp == 3 ? ReadLE32(&data[0x3A]) : 0);
+    BitfieldChannel blue(comp == 3 ? ReadLE32(&data[0x3E]) : 0);
+    BitfieldChannel alpha(comp == 3 && infoHeaderSize >= 56 && size >= 0x46 ? ReadLE32(&data[0x42]) : 0);
+
+    uint32_t bytesPerPixel = bpp / 8;
+    uint32_t stride        = ROUNDUP(width * bytesPerPixel, 4);
+    if (dataPos > size || (uint64_t) stride * height > size - dataPos) {
+        DEBUG_FUNCTION_LINE_ERR("BMP is truncated");
+        return {};
+    }
+
+    auto pixels = make_unique_nothrow<uint32_t[]>(width * height);
+    if (!pixels) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to allocate image surface");
+        return {};
+    }
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t *row = data + dataPos + (bottomUp ? height - 1 - y : y) * stride;
+        uint32_t *dst      = pixels.get() + y * width;
+        if (comp == 3) {
+            for (int32_t x = 0; x < width; x++) {
+                uint32_t px = ReadLE32(row + x * 4);
+                dst[x]      = Premultiply(red.Get(px, 0), green.Get(px, 0), blue.Get(px, 0), alpha.Get(px, 0xFF));
+            }
+            continue;
+        }
+        for (int32_t x = 0; x < width; x++) {
+            const uint8_t *px = row + x * bytesPerPixel;
+            dst[x]            = Premultiply(px[2], px[1], px[0], 0xFF);
+        }
+    }
+
+    auto surface = MakeSurface(width, height, std::move(pixels));
+    if (!surface) {
+        return {};
+    }
+    return ScaleIfNeeded(std::move(*surface), targetWidth, targetHeight);
+}
+
+std::optional<std::unique_ptr<ImageSurface>> ImageSurface::Scale(uint32_t width, uint32_t height) const {
+    if (width == 0 || height == 0) {
+        return {};
+    }
+    auto pixels = make_unique_nothrow<uint32_t[]>(width * height);
+    if (!pixels) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to allocate image surface");
+        return {};
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+        uint32_t srcY0 = y * mHeight / height;
+        uint32_t srcY1 = std::max((y + 1) * mHeight / height, srcY0 + 1);
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t srcX0 = x * mWidth / width;
+            uint32_t srcX1 = std::max((x + 1) * mWidth / width, srcX0 + 1);
+
+            // Premultiplied pixels can be averaged per channel
+            uint32_t sum[4] = {};
+            for (uint32_t sy = srcY0; sy < srcY1; sy++) {
+                for (uint32_t sx = srcX0; sx < srcX1; sx++) {
+                    uint32_t px = mPixels[sy * mWidth + sx];
+                    sum[0] += px >> 24;
+                    sum[1] += (px >> 16) & 0xFF;
+                    sum[2] += (px >> 8) & 0xFF;
+                    sum[3] += px & 0xFF;
+                }
+            }
+            uint32_t count             = (srcY1 - srcY0) * (srcX1 - srcX0);
+            pixels[y * width + x] = ((sum[0] / count) << 24) | ((sum[1] / count) << 16) | ((sum[2] / count) << 8) | (sum[3] / count);
+        }
+    }
+    return MakeSurface(width, height, std::move(pixels));
+}
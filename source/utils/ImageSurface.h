@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+/**
+ * A decoded image in premultiplied 0xRRGGBBAA pixels, ready to be blitted with DrawUtils::drawImage.
+ */
+class ImageSurface {
+public:
+    ImageSurface(uint32_t width, uint32_t height, std::unique_ptr<uint32_t[]> pixels) : mWidth(width), mHeight(height), mPixels(std::move(pixels)) {
+    }
+
+    //! Decodes a PNG of any color type. If targetWidth and targetHeight are set the image is scaled to that size.
+    static std::optional<std::unique_ptr<ImageSurface>> LoadPNG(const uint8_t *data, uint32_t size, uint32_t targetWidth = 0, uint32_t targetHeight = 0);
+
+    //! Decodes an uncompressed 24 or 32 bit BMP. If targetWidth and targetHeight are set the image is scaled to that size.
+    static std::optional<std::unique_ptr<ImageSurface>> LoadBMP(const uint8_t *data, uint32_t size, uint32_t targetWidth = 0, uint32_t targetHeight = 0);
+
+    //! Returns a copy scaled to width x height. Downscaling averages all source pixels that end up in a target pixel.
+    [[nodiscard]] std::optional<std::unique_ptr<ImageSurface>> Scale(uint32_t width, uint32_t height) const;
+
+    [[nodiscard]] uint32_t GetWidth() const {
+        return mWidth;
+    }
+
+    [[nodiscard]] uint32_t GetHeight() const {
+        return mHeight;
+    }
+
+    [[nodiscard]] const uint32_t *GetPixels() const {
+        return mPixels.get();
+    }
+
+private:
+    static std::optional<std::unique_ptr<ImageSurface>> ScaleIfNeeded(std::unique_ptr<ImageSurface> image, uint32_t targetWidth, uint32_t targetHeight);
+
+    uint32_t mWidth;
+    uint32_t mHeight;
+    std::unique_ptr<uint32_t[]> mPixels;
+};
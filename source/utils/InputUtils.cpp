@@ -1,9 +1,33 @@
 #include "InputUtils.h"
+#include "logger.h"
+#include <atomic>
 #include <coreinit/thread.h>
+#include <coreinit/time.h>
 #include <padscore/kpad.h>
 #include <padscore/wpad.h>
 #include <vpad/input.h>
 
+#define WPAD_CHANNEL_COUNT 4
+
+// One bit per channel, updated by the connect callback which may run on a different thread.
+static std::atomic<uint32_t> connectedChannels = 0;
+// Last known extension of every channel, only accessed by the thread that reads the input.
+static WPADExtensionType channelExtensions[WPAD_CHANNEL_COUNT];
+static KPADConnectCallback previousConnectCallbacks[WPAD_CHANNEL_COUNT];
+
+static void ConnectCallback(KPADChan chan, int32_t status) {
+    if ((uint32_t) chan < WPAD_CHANNEL_COUNT) {
+        if (status == WPAD_ERROR_NONE) {
+            connectedChannels.fetch_or(1u << chan);
+        } else {
+            connectedChannels.fetch_and(~(1u << chan));
+        }
+        if (previousConnectCallbacks[chan]) {
+            previousConnectCallbacks[chan](chan, status);
+        }
+    }
+}
+
 uint32_t remapWiiMoteButtons(uint32_t buttons) {
     uint32_t convButtons = 0;
 
@@ -94,26 +118,39 @@ uint32_t remapClassicButtons(uint32_t buttons) {
     return convButtons;
 }
 
-InputUtils::InputData InputUtils::getControllerInput() {
+InputUtils::InputData InputUtils::getVPADInput(uint32_t timeoutMs) {
     InputData inputData     = {};
     VPADStatus vpadStatus   = {};
     VPADReadError vpadError = VPAD_READ_UNINITIALIZED;
-    int maxAttempts         = 100;
+    OSTime deadline         = OSGetTime() + OSMillisecondsToTicks(timeoutMs);
     do {
         if (VPADRead(VPAD_CHAN_0, &vpadStatus, 1, &vpadError) > 0 && vpadError == VPAD_READ_SUCCESS) {
-            inputData.trigger = vpadStatus.trigger;
-            inputData.hold    = vpadStatus.hold;
-            inputData.release = vpadStatus.release;
+            inputData.trigger   = vpadStatus.trigger;
+            inputData.hold      = vpadStatus.hold;
+            inputData.release   = vpadStatus.release;
+            inputData.timestamp = OSGetTime();
         } else {
             OSSleepTicks(OSMillisecondsToTicks(1));
         }
-    } while (--maxAttempts > 0 && vpadError == VPAD_READ_NO_SAMPLES);
+    } while (vpadError == VPAD_READ_NO_SAMPLES && OSGetTime() < deadline);
+
+    return inputData;
+}
+
+InputUtils::InputData InputUtils::getControllerInput() {
+    InputData inputData = getVPADInput(100);
 
     KPADStatus kpadStatus = {};
     KPADError kpadError   = KPAD_ERROR_UNINITIALIZED;
-    for (int32_t i = 0; i < 4; i++) {
+    uint32_t connected    = connectedChannels.load();
+    for (int32_t i = 0; i < WPAD_CHANNEL_COUNT; i++) {
+        if (!(connected & (1u << i))) {
+            continue;
+        }
         if (KPADReadEx((KPADChan) i, &kpadStatus, 1, &kpadError) > 0) {
             if (kpadError == KPAD_ERROR_OK && kpadStatus.extensionType != 0xFF) {
+                channelExtensions[i] = (WPADExtensionType) kpadStatus.extensionType;
+                inputData.timestamp  = OSGetTime();
                 if (kpadStatus.extensionType == WPAD_EXT_CORE || kpadStatus.extensionType == WPAD_EXT_NUNCHUK) {
                     inputData.trigger |= remapWiiMoteButtons(kpadStatus.trigger);
                     inputData.hold |= remapWiiMoteButtons(kpadStatus.hold);
@@ -130,11 +167,81 @@ InputUtils::InputData InputUtils::getControllerInput() {
     return inputData;
 }
 
+bool InputUtils::isHeldWithin(uint32_t buttons, uint32_t windowMs, bool includeKPAD, uint32_t *gamePadButtons) {
+    OSTime start    = OSGetTime();
+    OSTime deadline = start + OSMillisecondsToTicks(windowMs);
+
+    InputData vpad = getVPADInput(windowMs);
+    bool held      = ((vpad.trigger | vpad.hold) & buttons) == buttons;
+    if (gamePadButtons) {
+        *gamePadButtons = vpad.trigger | vpad.hold;
+    }
+    if (held || !includeKPAD) {
+        DEBUG_FUNCTION_LINE("Boot key check took %d us", (uint32_t) OSTicksToMicroseconds(OSGetTime() - start));
+        return held;
+    }
+
+    Init();
+    // Controllers often don't report anything on the first read, keep reading until every one has sent a sample.
+    uint32_t pending = connectedChannels.load();
+    while (pending && !held && OSGetTime() < deadline) {
+        KPADStatus kpadStatus = {};
+        KPADError kpadError   = KPAD_ERROR_UNINITIALIZED;
+        for (int32_t i = 0; i < WPAD_CHANNEL_COUNT; i++) {
+            if (!(pending & (1u << i)) || KPADReadEx((KPADChan) i, &kpadStatus, 1, &kpadError) <= 0 ||
+                kpadError != KPAD_ERROR_OK || kpadStatus.extensionType == 0xFF) {
+                continue;
+            }
+            pending &= ~(1u << i);
+            uint32_t hold = kpadStatus.extensionType == WPAD_EXT_CORE || kpadStatus.extensionType == WPAD_EXT_NUNCHUK
+                                    ? remapWiiMoteButtons(kpadStatus.hold)
+                                    : remapClassicButtons(kpadStatus.classic.hold);
+            held = held || (hold & buttons) == buttons;
+        }
+        if (pending && !held) {
+            OSSleepTicks(OSMillisecondsToTicks(1));
+        }
+    }
+    DeInit();
+
+    DEBUG_FUNCTION_LINE("Boot key check took %d us", (uint32_t) OSTicksToMicroseconds(OSGetTime() - start));
+    return held;
+}
+
+WPADExtensionType InputUtils::getConnectedExtension(WPADChan chan) {
+    if ((uint32_t) chan >= WPAD_CHANNEL_COUNT || !(connectedChannels.load() & (1u << chan))) {
+        return WPAD_EXT_DEV_NOT_FOUND;
+    }
+    return channelExtensions[chan];
+}
+
 void InputUtils::Init() {
     KPADInit();
     WPADEnableURCC(1);
+
+    // Controllers that are already connected won't trigger the callback
+    uint32_t connected = 0;
+    for (int32_t i = 0; i < WPAD_CHANNEL_COUNT; i++) {
+        WPADExtensionType ext{};
+        if (WPADProbe((WPADChan) i, &ext) == 0) {
+            connected |= 1u << i;
+            channelExtensions[i] = ext;
+        } else {
+            channelExtensions[i] = WPAD_EXT_CORE;
+        }
+    }
+    connectedChannels.store(connected);
+    for (int32_t i = 0; i < WPAD_CHANNEL_COUNT; i++) {
+        previousConnectCallbacks[i] = KPADSetConnectCallback((KPADChan) i, ConnectCallback);
+    }
+    DEBUG_FUNCTION_LINE_VERBOSE("Connected WPAD channels: 0x%X", connected);
 }
 
 void InputUtils::DeInit() {
+    for (int32_t i = 0; i < WPAD_CHANNEL_COUNT; i++) {
+        KPADSetConnectCallback((KPADChan) i, previousConnectCallbacks[i]);
+        previousConnectCallbacks[i] = nullptr;
+    }
+    connectedChannels.store(0);
     KPADShutdown();
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
+#include <coreinit/time.h>
 #include <cstdint>
+#include <padscore/wpad.h>
 #include <vpad/input.h>
 
 class InputUtils {
@@ -8,10 +10,27 @@ public:
         uint32_t trigger = 0;
         uint32_t hold    = 0;
         uint32_t release = 0;
+        // Time the input has been read, can be used to measure the latency until it's visible.
+        OSTime timestamp = 0;
     } InputData;
 
+    //! Initializes KPAD, probes all channels once and keeps track of (dis)connected controllers afterwards.
     static void Init();
     static void DeInit();
 
+    //! Reads the GamePad and all connected WPAD controllers.
     static InputData getControllerInput();
+
+    //! Returns the extension of the controller connected to chan or WPAD_EXT_DEV_NOT_FOUND.
+    //! Doesn't talk to the controller, the connection state is updated by callbacks and every read.
+    static WPADExtensionType getConnectedExtension(WPADChan chan);
+
+    //! Returns the first GamePad sample that arrives within timeoutMs. Doesn't require Init().
+    static InputData getVPADInput(uint32_t timeoutMs);
+
+    //! Checks if all buttons (VPAD_BUTTON_*) are held within windowMs, the GamePad is checked first.
+    //! With includeKPAD, KPAD is initialized for the check and every connected controller is sampled as well.
+    //! Returns as soon as the buttons are held or every controller has reported a sample.
+    //! If gamePadButtons is set, it receives all buttons held on the GamePad.
+    static bool isHeldWithin(uint32_t buttons, uint32_t windowMs, bool includeKPAD, uint32_t *gamePadButtons = nullptr);
 };
@@ -0,0 +1,189 @@
+#include "CoreThread.h"
+#include "logger.h"
+#include <atomic>
+#include <coreinit/thread.h>
+#include <coreinit/time.h>
+#include <cstdarg>
+#include <cstdio>
+
+// Records are formatted by the thread that logs and written to the log handlers later.
+#define LOG_RING_SLOTS        256
+#define LOG_RECORD_SIZE       320
+#define LOG_DRAIN_INTERVAL_MS 10
+// Without a drain thread the records are written out once this many slots are in use.
+#define LOG_FLUSH_THRESHOLD   (LOG_RING_SLOTS * 3 / 4)
+
+namespace {
+    struct LogRecord {
+        // Equals the enqueue position once the record can be written out, see Enqueue/Drain.
+        std::atomic<uint32_t> sequence;
+        char text[LOG_RECORD_SIZE - sizeof(std::atomic<uint32_t>)];
+    };
+
+    LogRecord ring[LOG_RING_SLOTS];
+    std::atomic<uint32_t> enqueuePos = 0;
+    // Only written while holding drainLock, producers read it to decide whether to flush.
+    std::atomic<uint32_t> dequeuePos = 0;
+    std::atomic<bool> ringReady      = false;
+
+    // Only one thread may drain at a time. Producers only take this if the ring is full.
+    std::atomic_flag drainLock = ATOMIC_FLAG_INIT;
+
+    CoreThread drainThread;
+    std::atomic<bool> drainRunning = false;
+
+    // Returns false if there was nothing to write out.
+    bool Drain() {
+        uint32_t start = dequeuePos.load(std::memory_order_relaxed);
+        uint32_t pos   = start;
+        while (true) {
+            auto &record = ring[pos % LOG_RING_SLOTS];
+            if (record.sequence.load(std::memory_order_acquire) != pos + 1) {
+                break;
+            }
+            WHBLogWrite(record.text);
+            record.sequence.store(pos + LOG_RING_SLOTS, std::memory_order_release);
+            pos++;
+        }
+        dequeuePos.store(pos, std::memory_order_relaxed);
+        return pos != start;
+    }
+
+    void LockDrain() {
+        // Sleep instead of yielding, the drain thread has a lower priority and might run on the same core.
+        while (drainLock.test_and_set(std::memory_order_acquire)) {
+            OSSleepTicks(OSMicrosecondsToTicks(100));
+        }
+    }
+
+    void UnlockDrain() {
+        drainLock.clear(std::memory_order_release);
+    }
+
+    // Returns the claimed record or nullptr if the ring is full.
+    LogRecord *Claim(uint32_t &pos) {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            auto &record = ring[pos % LOG_RING_SLOTS];
+            auto diff    = (int32_t) (record.sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return &record;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Enqueue(bool newline, const char *fmt, va_list args) {
+        if (!ringReady.load(std::memory_order_acquire)) {
+            // No log handlers yet, this is how errors are logged in release builds.
+            char buffer[LOG_RECORD_SIZE];
+            vsnprintf(buffer, sizeof(buffer), fmt, args);
+            OSReport(newline ? "%s\n" : "%s", buffer);
+            return;
+        }
+
+        uint32_t pos;
+        LogRecord *record;
+        while (!(record = Claim(pos))) {
+            // The drain thread couldn't keep up, help out instead of losing messages.
+            LockDrain();
+            bool progress = Drain();
+            UnlockDrain();
+            if (!progress) {
+                // The oldest record is still being written by another thread
+                OSSleepTicks(OSMicrosecondsToTicks(100));
+            }
+        }
+
+        auto capacity = sizeof(record->text) - (newline ? 1 : 0);
+        auto length   = vsnprintf(record->text, capacity, fmt, args);
+        if (length < 0) {
+            length = 0;
+        } else if ((size_t) length >= capacity) {
+            length = (int) capacity - 1;
+        }
+        if (newline) {
+            record->text[length]     = '\n';
+            record->text[length + 1] = '\0';
+        }
+        record->sequence.store(pos + 1, std::memory_order_release);
+
+        // No drain thread, e.g. because worker cores are disabled. The records are kept until the ring is nearly full,
+        // the next module entrypoint, an error screen or the exit, see flushLogging.
+        if (!drainRunning && pos + 1 - dequeuePos.load(std::memory_order_relaxed) >= LOG_FLUSH_THRESHOLD) {
+            flushLogging();
+        }
+    }
+} // namespace
+
+void logBufferPrintf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    Enqueue(true, fmt, args);
+    va_end(args);
+}
+
+void logBufferWritef(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    Enqueue(false, fmt, args);
+    va_end(args);
+}
+
+void startLogBuffer() {
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos.store(0, std::memory_order_relaxed);
+    ringReady.store(true, std::memory_order_release);
+
+    startLogDrainThread();
+}
+
+void stopLogBuffer() {
+    stopLogDrainThread();
+    ringReady.store(false, std::memory_order_release);
+}
+
+void startLogDrainThread() {
+    if (!ringReady.load(std::memory_order_acquire) || drainThread.IsStarted()) {
+        return;
+    }
+
+    drainRunning = true;
+    auto drain   = []() {
+        while (drainRunning) {
+            if (!drainLock.test_and_set(std::memory_order_acquire)) {
+                Drain();
+                UnlockDrain();
+            }
+            OSSleepTicks(OSMillisecondsToTicks(LOG_DRAIN_INTERVAL_MS));
+        }
+    };
+    if (!drainThread.Start(std::move(drain), CoreThread::GetWorkerAffinity(1), "EnvironmentLoader Log", 30)) {
+        // Records are written out by the thread that logs them once the ring is nearly full instead.
+        drainRunning = false;
+        flushLogging();
+    }
+}
+
+void stopLogDrainThread() {
+    drainRunning = false;
+    drainThread.Join();
+    flushLogging();
+}
+
+void flushLogging() {
+    if (!ringReady.load(std::memory_order_acquire)) {
+        return;
+    }
+    LockDrain();
+    Drain();
+    UnlockDrain();
+}
@@ -187,6 +187,11 @@ public:
         return mMemory.IsAllocated();
     }
 
+    //! Bytes currently allocated from the heap, including the bookkeeping of the heap itself.
+    [[nodiscard]] uint32_t GetUsedSize() const {
+        return mHeapHandle ? mSize - MEMGetTotalFreeSizeForExpHeap(mHeapHandle) : 0;
+    }
+
     [[nodiscard]] std::optional<ExpHeapMemory> Alloc(uint32_t size, int align) const {
         return ExpHeapMemory::Alloc(mHeapHandle, size, align);
     }
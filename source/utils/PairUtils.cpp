@@ -20,28 +20,29 @@ void PairMenu::drawPairKPADScreen() const {
     DrawUtils::setFontSize(26);
 
     std::string textLine1 = "Press the SYNC Button on the controller you want to pair.";
-    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine1.c_str()) / 2, 40, textLine1.c_str(), true);
+    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine1) / 2, 40, textLine1, true);
 
 
-    WPADExtensionType ext{};
     for (int i = 0; i < 4; i++) {
-        bool isConnected     = WPADProbe((WPADChan) i, &ext) == 0;
+        uint32_t slot        = (mDrawnSlots >> (i * 2)) & 3;
         std::string textLine = string_format("Slot %d: ", i + 1);
-        if (isConnected) {
-            textLine += ext == WPAD_EXT_PRO_CONTROLLER ? "Pro Controller" : "Wiimote";
+        if (slot == 2) {
+            textLine += "Pro Controller";
+        } else if (slot == 1) {
+            textLine += "Wiimote";
         } else {
             textLine += "No controller";
         }
 
-        DrawUtils::print(300, 140 + (i * 30), textLine.c_str());
+        DrawUtils::print(300, 140 + (i * 30), textLine);
     }
 
     DrawUtils::setFontSize(26);
 
     std::string gamepadSyncText1 = "If you are pairing a Wii U GamePad, press the SYNC Button";
     std::string gamepadSyncText2 = "on your Wii U console one more time";
-    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(gamepadSyncText1.c_str()) / 2, SCREEN_HEIGHT - 100, gamepadSyncText1.c_str(), true);
-    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(gamepadSyncText2.c_str()) / 2, SCREEN_HEIGHT - 70, gamepadSyncText2.c_str(), true);
+    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(gamepadSyncText1) / 2, SCREEN_HEIGHT - 100, gamepadSyncText1, true);
+    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(gamepadSyncText2) / 2, SCREEN_HEIGHT - 70, gamepadSyncText2, true);
 
     DrawUtils::setFontSize(16);
 
@@ -51,50 +52,61 @@ void PairMenu::drawPairKPADScreen() const {
     DrawUtils::endDraw();
 }
 
-void PairMenu::drawPairScreen() const {
+// Area of the "seconds remaining" line, the only part of the GamePad screen that changes on its own.
+#define PAIR_COUNTDOWN_RECT Rect{0, SCREEN_HEIGHT - 80 - 24, SCREEN_WIDTH, 32}
+
+void PairMenu::drawPairScreen(uint32_t secondsRemaining) const {
     DrawUtils::beginDraw();
     DrawUtils::clear(COLOR_BACKGROUND);
 
     DrawUtils::setFontColor(COLOR_TEXT);
 
-    // Convert the pin to symbols and set the text
-    static char pinSymbols[][4] = {
-            "\u2660",
-            "\u2665",
-            "\u2666",
-            "\u2663"};
-
-    uint32_t pincode = mGamePadPincode;
-
-    std::string pin = std::string(pinSymbols[(pincode / 1000) % 10]) +
-                      pinSymbols[(pincode / 100) % 10] +
-                      pinSymbols[(pincode / 10) % 10] +
-                      pinSymbols[pincode % 10];
-
     std::string textLine1 = "Press the SYNC Button on the Wii U GamePad,";
     std::string textLine2 = "and enter the four symbols shown below.";
 
     DrawUtils::setFontSize(26);
 
-    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine1.c_str()) / 2, 60, textLine1.c_str(), true);
-    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine2.c_str()) / 2, 100, textLine2.c_str(), true);
+    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine1) / 2, 60, textLine1, true);
+    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine2) / 2, 100, textLine2, true);
 
     DrawUtils::setFontSize(100);
-    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(pin.c_str()) / 2, (SCREEN_HEIGHT / 2) + 40, pin.c_str(), true);
-
-    DrawUtils::setFontSize(20);
+    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(mPinSymbols) / 2, (SCREEN_HEIGHT / 2) + 40, mPinSymbols, true);
 
-    std::string textLine3 = string_format("(%d seconds remaining) ", mGamePadSyncTimeout - (uint32_t) (OSTicksToSeconds(OSGetTime() - mSyncGamePadStartTime)));
-    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine3.c_str()) / 2, SCREEN_HEIGHT - 80, textLine3.c_str(), true);
+    drawPairCountdown(secondsRemaining);
 
     DrawUtils::setFontSize(26);
 
     std::string textLine4 = "Press the SYNC Button on the Wii U console to exit.";
-    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine4.c_str()) / 2, SCREEN_HEIGHT - 40, textLine4.c_str(), true);
+    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine4) / 2, SCREEN_HEIGHT - 40, textLine4, true);
 
     DrawUtils::endDraw();
 }
 
+// Only draws the countdown, must be called between beginDraw and endDraw.
+void PairMenu::drawPairCountdown(uint32_t secondsRemaining) const {
+    DrawUtils::setFontColor(COLOR_TEXT);
+    DrawUtils::setFontSize(20);
+
+    std::string textLine3 = string_format("(%d seconds remaining) ", secondsRemaining);
+    DrawUtils::print(SCREEN_WIDTH / 2 + DrawUtils::getTextWidth(textLine3) / 2, SCREEN_HEIGHT - 80, textLine3, true);
+}
+
+uint32_t PairMenu::GetConnectedSlots() {
+    uint32_t slots = 0;
+    for (int i = 0; i < 4; i++) {
+        WPADExtensionType ext = InputUtils::getConnectedExtension((WPADChan) i);
+        if (ext != WPAD_EXT_DEV_NOT_FOUND) {
+            slots |= (ext == WPAD_EXT_PRO_CONTROLLER ? 2 : 1) << (i * 2);
+        }
+    }
+    return slots;
+}
+
+uint32_t PairMenu::GetSecondsRemaining() const {
+    auto elapsed = (uint32_t) OSTicksToSeconds(OSGetTime() - mSyncGamePadStartTime);
+    return elapsed < mGamePadSyncTimeout ? mGamePadSyncTimeout - elapsed : 0;
+}
+
 PairMenu::PairMenu() {
     CCRSysInit();
 
@@ -105,7 +117,7 @@ PairMenu::PairMenu() {
     mIMHandle = IM_Open();
     if (mIMHandle < 0) {
         DEBUG_FUNCTION_LINE_ERR("PairMenu: IM_Open failed");
-        OSFatal("EnvironmentLoader: PairMenu: IM_Open failed");
+        FATAL_ERROR("EnvironmentLoader: PairMenu: IM_Open failed");
     }
     mIMRequest = (IMRequest *) memalign(0x40, sizeof(IMRequest));
 
@@ -114,7 +126,7 @@ PairMenu::PairMenu() {
 
     if (!mIMRequest || !mIMCancelRequest) {
         DEBUG_FUNCTION_LINE_ERR("Failed to allocate im request");
-        OSFatal("EnvironmentLoader: PairMenu: Failed to allocate im request");
+        FATAL_ERROR("EnvironmentLoader: PairMenu: Failed to allocate im request");
     }
 
     mIMEventMask = IM_EVENT_SYNC;
@@ -140,7 +152,8 @@ PairMenu::~PairMenu() {
     CCRSysExit();
 }
 
-bool PairMenu::ProcessPairScreen() {
+bool PairMenu::ProcessPairScreen(bool &drawn) {
+    drawn = false;
     switch (mState) {
         case STATE_SYNC_WPAD: {
             // WPAD syncing stops after ~18 seconds, make sure to restart it.
@@ -172,6 +185,17 @@ bool PairMenu::ProcessPairScreen() {
                 break;
             }
 
+            // Convert the pin to symbols once, it doesn't change while pairing
+            static const char *pinSymbols[] = {
+                    "\u2660",
+                    "\u2665",
+                    "\u2666",
+                    "\u2663"};
+            mPinSymbols = std::string(pinSymbols[(mGamePadPincode / 1000) % 10]) +
+                          pinSymbols[(mGamePadPincode / 100) % 10] +
+                          pinSymbols[(mGamePadPincode / 10) % 10] +
+                          pinSymbols[mGamePadPincode % 10];
+
             // Pairing has started, save start time
             mSyncGamePadStartTime = OSGetTime();
             mState                = STATE_PAIRING;
@@ -202,17 +226,43 @@ bool PairMenu::ProcessPairScreen() {
         case STATE_WAIT:
             break;
     }
+    // Only redraw if something visible has changed, the screen keeps showing the last frame otherwise.
     switch (mState) {
         case STATE_WAIT: {
+            mDrawnScreen = SCREEN_NONE;
             return false;
         }
-        case STATE_SYNC_WPAD:
-            drawPairKPADScreen();
+        case STATE_SYNC_WPAD: {
+            uint32_t slots = GetConnectedSlots();
+            if (mDrawnScreen != SCREEN_KPAD || slots != mDrawnSlots) {
+                mDrawnScreen = SCREEN_KPAD;
+                mDrawnSlots  = slots;
+                drawPairKPADScreen();
+                drawn = true;
+            }
             break;
+        }
         case STATE_SYNC_GAMEPAD:
         case STATE_PAIRING:
         case STATE_CANCEL: {
-            drawPairScreen();
+            uint32_t seconds = GetSecondsRemaining();
+            if (mDrawnScreen != SCREEN_GAMEPAD || mDrawnPincode != mGamePadPincode) {
+                mDrawnScreen  = SCREEN_GAMEPAD;
+                mDrawnPincode = mGamePadPincode;
+                mDrawnSeconds = seconds;
+                drawPairScreen(seconds);
+                drawn = true;
+            } else if (seconds != mDrawnSeconds) {
+                // The big PIN glyphs stay on the canvas, only repaint the countdown.
+                mDrawnSeconds = seconds;
+                DrawUtils::beginDraw();
+                DrawUtils::setClipRect(PAIR_COUNTDOWN_RECT);
+                DrawUtils::drawRectFilled(PAIR_COUNTDOWN_RECT.x, PAIR_COUNTDOWN_RECT.y, PAIR_COUNTDOWN_RECT.w, PAIR_COUNTDOWN_RECT.h, COLOR_BACKGROUND);
+                drawPairCountdown(seconds);
+                DrawUtils::resetClipRect();
+                DrawUtils::endDraw();
+                drawn = true;
+            }
             break;
         }
     }
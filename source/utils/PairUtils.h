@@ -7,6 +7,7 @@
 #include <coreinit/time.h>
 #include <malloc.h>
 #include <nn/ccr/sys.h>
+#include <string>
 
 class PairMenu {
 public:
@@ -14,15 +15,29 @@ public:
 
     ~PairMenu();
 
-    bool ProcessPairScreen();
+    //! Returns true while a pair screen is shown. drawn is set if anything on the screen has changed this frame.
+    bool ProcessPairScreen(bool &drawn);
 
     static void SyncButtonCallback(IOSError error, void *arg);
 
-    void drawPairScreen() const;
+    void drawPairScreen(uint32_t secondsRemaining) const;
+
+    void drawPairCountdown(uint32_t secondsRemaining) const;
 
     void drawPairKPADScreen() const;
 
 private:
+    enum PairScreen {
+        SCREEN_NONE,
+        SCREEN_KPAD,
+        SCREEN_GAMEPAD,
+    };
+
+    //! Returns 2 bits per WPAD channel: 0 = no controller, 1 = Wiimote, 2 = Pro Controller
+    static uint32_t GetConnectedSlots();
+
+    [[nodiscard]] uint32_t GetSecondsRemaining() const;
+
     enum PairMenuState {
         STATE_WAIT, // Wait for SYNC button press
         STATE_SYNC_WPAD,
@@ -40,4 +55,11 @@ private:
     PairMenuState mState         = STATE_WAIT;
     uint32_t mGamePadSyncTimeout = 120;
     IMEventMask mIMEventMask{};
+
+    // What is currently on the screen, the screen is only redrawn if any of this changes.
+    PairScreen mDrawnScreen = SCREEN_NONE;
+    uint32_t mDrawnSlots    = 0;
+    uint32_t mDrawnPincode  = 0;
+    uint32_t mDrawnSeconds  = 0;
+    std::string mPinSymbols;
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Iterates over the codepoints of an UTF-8 string without allocating and independent of the current locale.
+ * Invalid or truncated sequences, overlong encodings and surrogates yield REPLACEMENT_CHARACTER and skip a single byte.
+ */
+class Utf8Decoder {
+public:
+    static constexpr uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+    explicit Utf8Decoder(std::string_view text) : mText(text) {
+    }
+
+    //! Returns false once the end of the text has been reached.
+    bool Next(uint32_t &codepoint) {
+        if (mPos >= mText.size()) {
+            return false;
+        }
+
+        auto lead = (uint8_t) mText[mPos];
+        if (lead < 0x80) {
+            codepoint = lead;
+            mPos++;
+            return true;
+        }
+
+        uint32_t length, minimum;
+        if ((lead & 0xE0) == 0xC0) {
+            length    = 2;
+            minimum   = 0x80;
+            codepoint = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            length    = 3;
+            minimum   = 0x800;
+            codepoint = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            length    = 4;
+            minimum   = 0x10000;
+            codepoint = lead & 0x07;
+        } else {
+            return Invalid(codepoint);
+        }
+
+        if (mText.size() - mPos < length) {
+            return Invalid(codepoint);
+        }
+        for (uint32_t i = 1; i < length; i++) {
+            auto cont = (uint8_t) mText[mPos + i];
+            if ((cont & 0xC0) != 0x80) {
+                return Invalid(codepoint);
+            }
+            codepoint = (codepoint << 6) | (cont & 0x3F);
+        }
+        if (codepoint < minimum || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+            return Invalid(codepoint);
+        }
+
+        mPos += length;
+        return true;
+    }
+
+private:
+    bool Invalid(uint32_t &codepoint) {
+        codepoint = REPLACEMENT_CHARACTER;
+        mPos++;
+        return true;
+    }
+
+    std::string_view mText;
+    size_t mPos = 0;
+};
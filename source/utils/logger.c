@@ -1,4 +1,4 @@
-#ifdef DEBUG
+#include "logger.h"
 #include <stdint.h>
 #include <whb/log_cafe.h>
 #include <whb/log_module.h>
@@ -7,19 +7,34 @@
 uint32_t moduleLogInit = false;
 uint32_t cafeLogInit   = false;
 uint32_t udpLogInit    = false;
-#endif // DEBUG
+uint32_t handlersInit  = false;
 
-void initLogging() {
-#ifdef DEBUG
+uint32_t gLogLevel     = LOG_LEVEL_DEFAULT;
+uint32_t gTraceLogging = false;
+
+static void initHandlers() {
+    if (handlersInit) {
+        return;
+    }
     if (!(moduleLogInit = WHBLogModuleInit())) {
         cafeLogInit = WHBLogCafeInit();
         udpLogInit  = WHBLogUdpInit();
     }
-#endif // DEBUG
+    startLogBuffer();
+    handlersInit = true;
+}
+
+void initLogging() {
+    if (gLogLevel > LOG_LEVEL_ERROR) {
+        initHandlers();
+    }
 }
 
 void deinitLogging() {
-#ifdef DEBUG
+    if (!handlersInit) {
+        return;
+    }
+    stopLogBuffer();
     if (moduleLogInit) {
         WHBLogModuleDeinit();
         moduleLogInit = false;
@@ -32,5 +47,29 @@ void deinitLogging() {
         WHBLogUdpDeinit();
         udpLogInit = false;
     }
-#endif // DEBUG
-}
\ No newline at end of file
+    handlersInit = false;
+}
+
+void setLogLevel(uint32_t level) {
+    if (level > LOG_LEVEL_TRACE) {
+        level = LOG_LEVEL_TRACE;
+    }
+    if (level > LOG_LEVEL_ERROR) {
+        initHandlers();
+    }
+    if (level != gLogLevel) {
+        gLogLevel = level;
+        DEBUG_FUNCTION_LINE("Log level is now %d", level);
+    }
+}
+
+bool parseLogLevel(const char *name, uint32_t length, uint32_t *level) {
+    static const char *names[] = {"error", "info", "verbose", "trace"};
+    for (uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strlen(names[i]) == length && strncmp(names[i], name, length) == 0) {
+            *level = i;
+            return true;
+        }
+    }
+    return false;
+}
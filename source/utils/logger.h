@@ -1,6 +1,8 @@
 #pragma once
 
 #include <coreinit/debug.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <whb/log.h>
 
@@ -11,8 +13,13 @@ extern "C" {
 #define LOG_APP_TYPE                "O"
 #define LOG_APP_NAME                "environment_loader"
 
-#define __FILENAME_X__              (strrchr(__FILE__, '\\') ? strrchr(__FILE__, '\\') + 1 : __FILE__)
-#define __FILENAME__                (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILENAME_X__)
+#ifdef __FILE_NAME__
+// Resolved at compile time
+#define __FILENAME__ __FILE_NAME__
+#else
+#define __FILENAME_X__ (strrchr(__FILE__, '\\') ? strrchr(__FILE__, '\\') + 1 : __FILE__)
+#define __FILENAME__   (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILENAME_X__)
+#endif
 
 #define LOG(LOG_FUNC, FMT, ARGS...) LOG_EX(LOG_FUNC, "", "", FMT, ##ARGS)
 
@@ -21,39 +28,89 @@ extern "C" {
         LOG_FUNC("[(%s)%18s][%23s]%30s@L%04d: " LOG_LEVEL "" FMT "" LINE_END, LOG_APP_TYPE, LOG_APP_NAME, __FILENAME__, __FUNCTION__, __LINE__, ##ARGS); \
     } while (0)
 
-
-#ifdef DEBUG
-
-#ifdef VERBOSE_DEBUG
-#define DEBUG_FUNCTION_LINE_VERBOSE(FMT, ARGS...) LOG(WHBLogPrintf, FMT, ##ARGS)
+// Levels for gLogLevel, every level includes the ones before it.
+#define LOG_LEVEL_ERROR   0
+#define LOG_LEVEL_INFO    1
+#define LOG_LEVEL_VERBOSE 2
+#define LOG_LEVEL_TRACE   3
+
+// The level a build starts with, it can be changed at runtime via setLogLevel.
+#if defined(VERBOSE_DEBUG)
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_VERBOSE
+#elif defined(DEBUG)
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_INFO
 #else
-#define DEBUG_FUNCTION_LINE_VERBOSE(FMT, ARGS...) while (0)
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_ERROR
 #endif
 
-#define DEBUG_FUNCTION_LINE(FMT, ARGS...)       LOG(WHBLogPrintf, FMT, ##ARGS)
+// Messages are formatted into a ring buffer which is written to the WHBLog handlers by a low priority thread,
+// see LogBuffer.cpp. Until the handlers are set up (a level above LOG_LEVEL_ERROR) messages go to OSReport.
+// Disabled levels cost a single branch, the arguments are not evaluated.
+#define LOG_IF(LEVEL, LOG_FUNC, FMT, ARGS...) \
+    do {                                      \
+        if (gLogLevel >= (LEVEL)) {           \
+            LOG(LOG_FUNC, FMT, ##ARGS);       \
+        }                                     \
+    } while (0)
 
-#define DEBUG_FUNCTION_LINE_WRITE(FMT, ARGS...) LOG(WHBLogWritef, FMT, ##ARGS)
+#define DEBUG_FUNCTION_LINE_VERBOSE(FMT, ARGS...) LOG_IF(LOG_LEVEL_VERBOSE, logBufferPrintf, FMT, ##ARGS)
 
-#define DEBUG_FUNCTION_LINE_WARN(FMT, ARGS...)  LOG_EX(WHBLogPrintf, "##WARN ## ", "", FMT, ##ARGS)
-#define DEBUG_FUNCTION_LINE_ERR(FMT, ARGS...)   LOG_EX(WHBLogPrintf, "##ERROR## ", "", FMT, ##ARGS)
+#define DEBUG_FUNCTION_LINE(FMT, ARGS...)         LOG_IF(LOG_LEVEL_INFO, logBufferPrintf, FMT, ##ARGS)
 
-#else
+#define DEBUG_FUNCTION_LINE_WRITE(FMT, ARGS...)   LOG_IF(LOG_LEVEL_INFO, logBufferWritef, FMT, ##ARGS)
+
+#define DEBUG_FUNCTION_LINE_WARN(FMT, ARGS...)    LOG_EX(logBufferPrintf, "##WARN ## ", "", FMT, ##ARGS)
+#define DEBUG_FUNCTION_LINE_ERR(FMT, ARGS...)     LOG_EX(logBufferPrintf, "##ERROR## ", "", FMT, ##ARGS)
 
-#define DEBUG_FUNCTION_LINE_VERBOSE(FMT, ARGS...) while (0)
+#define DEBUG_FUNCTION_LINE_TRACE(FMT, ARGS...)                     \
+    do {                                                            \
+        if (gTraceLogging) {                                        \
+            LOG_EX(logBufferPrintf, "##TRACE## ", "", FMT, ##ARGS); \
+        }                                                           \
+    } while (0)
 
-#define DEBUG_FUNCTION_LINE(FMT, ARGS...)         while (0)
+void logBufferPrintf(const char *fmt, ...);
 
-#define DEBUG_FUNCTION_LINE_WRITE(FMT, ARGS...)   while (0)
+void logBufferWritef(const char *fmt, ...);
 
-#define DEBUG_FUNCTION_LINE_WARN(FMT, ARGS...)    LOG_EX(OSReport, "##WARN ## ", "\n", FMT, ##ARGS)
-#define DEBUG_FUNCTION_LINE_ERR(FMT, ARGS...)     LOG_EX(OSReport, "##ERROR## ", "\n", FMT, ##ARGS)
+void startLogBuffer();
 
-#endif
+void stopLogBuffer();
 
+//! Starts the thread that writes out the log records, if worker cores are allowed (see CoreThread::SetWorkerCount).
+//! Without it, every record is written out by the thread that logged it.
+void startLogDrainThread();
+
+//! Stops the drain thread and writes out all pending records.
+void stopLogDrainThread();
+
+//! Current log level, see LOG_LEVEL_*
+extern uint32_t gLogLevel;
+
+//! Enables DEBUG_FUNCTION_LINE_TRACE, see BootConfig::trace
+extern uint32_t gTraceLogging;
+
+//! Sets up the log handlers if the build default level needs them.
 void initLogging();
 
 void deinitLogging();
 
+//! Changes the log level, the log handlers are set up the first time a level above LOG_LEVEL_ERROR is selected.
+void setLogLevel(uint32_t level);
+
+//! Parses "error", "info", "verbose" or "trace". Returns false for anything else.
+bool parseLogLevel(const char *name, uint32_t length, uint32_t *level);
+
+//! Writes out all buffered log messages. Does nothing while the log handlers are not set up.
+void flushLogging();
+
+//! Use instead of OSFatal, makes sure the log messages that lead to the error aren't lost.
+#define FATAL_ERROR(MSG)  \
+    do {                  \
+        flushLogging();   \
+        OSFatal(MSG);     \
+    } while (0)
+
 #ifdef __cplusplus
 }
 #endif
@@ -100,8 +100,39 @@ struct Outline {
     uint_least16_t capCurves;
     uint_least16_t numLines;
     uint_least16_t capLines;
+    /* Set if the arrays live in a caller provided arena and can't grow. */
+    int fixedCapacity;
+    /* Optional space for the temporary arrays of simple_outline, used instead of calloc. */
+    uint8_t *tmp;
+    size_t tmpSize;
 };
 
+/* 16.16 fixed-point versions of the structs above, used by sft_render_fixed. */
+typedef struct FixedPoint FixedPoint;
+typedef struct FixedCell FixedCell;
+typedef struct FixedOutline FixedOutline;
+typedef struct FixedRaster FixedRaster;
+
+struct FixedPoint {
+    int32_t x, y;
+};
+struct FixedCell {
+    int32_t area, cover;
+};
+struct FixedOutline {
+    FixedPoint *points;
+    uint_least16_t numPoints;
+    uint_least16_t capPoints;
+};
+struct FixedRaster {
+    FixedCell *cells;
+    int width;
+    int height;
+};
+
+#define FIX_SHIFT 16
+#define FIX_ONE   (1 << FIX_SHIFT)
+
 struct Raster {
     Cell *cells;
     int width;
@@ -177,6 +208,13 @@ static void post_process(Raster buf, uint8_t *image);
 /* glyph rendering */
 static int render_outline(Outline *outl, double transform[6], SFT_Image image);
 
+/* fixed-point rendering */
+static void transform_points_fixed(unsigned int numPts, const Point *points, FixedPoint *out, double trf[6]);
+static void clip_points_fixed(unsigned int numPts, FixedPoint *points, int width, int height);
+static int tesselate_curves_fixed(Outline *outl, FixedOutline *fixed);
+static void draw_line_fixed(FixedRaster buf, FixedPoint origin, FixedPoint goal);
+static void post_process_fixed(FixedRaster buf, uint8_t *image);
+
 /* function implementations */
 
 const char *
@@ -362,6 +400,104 @@ failure:
     return -1;
 }
 
+/* Takes size bytes from the arena, 8 byte aligned. */
+static void *
+arena_take(uint8_t **arena, size_t *remaining, size_t size) {
+    uint8_t *ptr;
+    size = (size + 7) & ~(size_t) 7;
+    if (size > *remaining)
+        return NULL;
+    ptr = *arena;
+    *arena += size;
+    *remaining -= size;
+    return ptr;
+}
+
+int sft_render_fixed(const SFT *sft, SFT_Glyph glyph, SFT_Image image, void *scratch, size_t scratchSize) {
+    uint_fast32_t outline;
+    double transform[6];
+    int bbox[4];
+    Outline outl;
+    FixedOutline fixed;
+    FixedRaster buf;
+    uint8_t *arena;
+    size_t remaining, numPixels, tmpSize, capPoints, capCurves, capLines;
+
+    if (outline_offset(sft->font, glyph, &outline) < 0)
+        return -1;
+    if (!outline)
+        return 0;
+    if (glyph_bbox(sft, outline, bbox) < 0)
+        return -1;
+    /* Same transformation as in sft_render */
+    transform[0] = sft->xScale / sft->font->unitsPerEm;
+    transform[1] = 0.0;
+    transform[2] = 0.0;
+    transform[4] = sft->xOffset - bbox[0];
+    if (sft->flags & SFT_DOWNWARD_Y) {
+        transform[3] = -sft->yScale / sft->font->unitsPerEm;
+        transform[5] = bbox[3] - sft->yOffset;
+    } else {
+        transform[3] = +sft->yScale / sft->font->unitsPerEm;
+        transform[5] = sft->yOffset - bbox[1];
+    }
+
+    /* 16.16 coordinates limit the size of a glyph */
+    if (image.width <= 0 || image.height <= 0 || image.width >= 0x4000 || image.height >= 0x4000)
+        return -1;
+
+    arena     = (uint8_t *) (((uintptr_t) scratch + 7) & ~(uintptr_t) 7);
+    remaining = scratchSize - (size_t) (arena - (uint8_t *) scratch);
+    if (arena - (uint8_t *) scratch > (ptrdiff_t) scratchSize)
+        return -1;
+
+    numPixels = (size_t) image.width * (size_t) image.height;
+    buf.cells = arena_take(&arena, &remaining, numPixels * sizeof(FixedCell));
+    if (!buf.cells)
+        return -1;
+    memset(buf.cells, 0, numPixels * sizeof(FixedCell));
+    buf.width  = image.width;
+    buf.height = image.height;
+
+    /* Split the rest of the arena between the outline arrays, leaving some room for the alignment of each array. */
+    tmpSize   = remaining / 10;
+    capPoints = MIN(remaining * 5 / 10 / (sizeof(Point) + sizeof(FixedPoint)), UINT16_MAX);
+    capCurves = MIN(remaining / 10 / sizeof(Curve), UINT16_MAX);
+    capLines  = MIN(remaining * 25 / 100 / sizeof(Line), UINT16_MAX);
+
+    memset(&outl, 0, sizeof outl);
+    outl.fixedCapacity = 1;
+    outl.tmpSize       = tmpSize;
+    outl.tmp           = arena_take(&arena, &remaining, tmpSize);
+    outl.points        = arena_take(&arena, &remaining, capPoints * sizeof(Point));
+    outl.curves        = arena_take(&arena, &remaining, capCurves * sizeof(Curve));
+    outl.lines         = arena_take(&arena, &remaining, capLines * sizeof(Line));
+    fixed.points       = arena_take(&arena, &remaining, capPoints * sizeof(FixedPoint));
+    if (!outl.tmp || !outl.points || !outl.curves || !outl.lines || !fixed.points || capPoints < 4 || capCurves < 1 || capLines < 1)
+        return -1;
+    outl.capPoints  = (uint_least16_t) capPoints;
+    outl.capCurves  = (uint_least16_t) capCurves;
+    outl.capLines   = (uint_least16_t) capLines;
+    fixed.capPoints = (uint_least16_t) capPoints;
+
+    if (decode_outline(sft->font, outline, 0, &outl) < 0)
+        return -1;
+
+    transform_points_fixed(outl.numPoints, outl.points, fixed.points, transform);
+    fixed.numPoints = outl.numPoints;
+    clip_points_fixed(fixed.numPoints, fixed.points, image.width, image.height);
+
+    if (tesselate_curves_fixed(&outl, &fixed) < 0)
+        return -1;
+
+    for (unsigned int i = 0; i < outl.numLines; ++i) {
+        draw_line_fixed(buf, fixed.points[outl.lines[i].beg], fixed.points[outl.lines[i].end]);
+    }
+
+    post_process_fixed(buf, image.pixels);
+    return 0;
+}
+
 /* This is sqrt(SIZE_MAX+1), as s1*s2 <= SIZE_MAX
  * if both s1 < MUL_NO_OVERFLOW and s2 < MUL_NO_OVERFLOW */
 #define MUL_NO_OVERFLOW ((size_t) 1 << (sizeof(size_t) * 4))
@@ -549,6 +685,8 @@ static int
 grow_points(Outline *outl) {
     void *mem;
     uint_fast16_t cap;
+    if (outl->fixedCapacity)
+        return -1;
     assert(outl->capPoints);
     /* Since we use uint_fast16_t for capacities, we have to be extra careful not to trigger integer overflow. */
     if (outl->capPoints > UINT16_MAX / 2)
@@ -565,6 +703,8 @@ static int
 grow_curves(Outline *outl) {
     void *mem;
     uint_fast16_t cap;
+    if (outl->fixedCapacity)
+        return -1;
     assert(outl->capCurves);
     if (outl->capCurves > UINT16_MAX / 2)
         return -1;
@@ -580,6 +720,8 @@ static int
 grow_lines(Outline *outl) {
     void *mem;
     uint_fast16_t cap;
+    if (outl->fixedCapacity)
+        return -1;
     assert(outl->capLines);
     if (outl->capLines > UINT16_MAX / 2)
         return -1;
@@ -1108,13 +1250,22 @@ simple_outline(SFT_Font *font, uint_fast32_t offset, unsigned int numContours, O
             goto failure;
     }
 
-    endPts = calloc(sizeof(uint_fast16_t), numContours);
-    if (endPts == NULL) {
-        goto failure;
-    }
-    flags = calloc(sizeof(uint8_t), numPts);
-    if (flags == NULL) {
-        goto failure;
+    if (outl->tmp) {
+        /* simple_outline never nests, so the temporary arrays can always start at the beginning of tmp. */
+        if (numContours * sizeof(uint_fast16_t) + numPts > outl->tmpSize)
+            return -1;
+        endPts = (uint_fast16_t *) outl->tmp;
+        flags  = outl->tmp + numContours * sizeof(uint_fast16_t);
+        memset(flags, 0, numPts);
+    } else {
+        endPts = calloc(sizeof(uint_fast16_t), numContours);
+        if (endPts == NULL) {
+            goto failure;
+        }
+        flags = calloc(sizeof(uint8_t), numPts);
+        if (flags == NULL) {
+            goto failure;
+        }
     }
 
     for (i = 0; i < numContours; ++i) {
@@ -1144,12 +1295,16 @@ simple_outline(SFT_Font *font, uint_fast32_t offset, unsigned int numContours, O
         beg = endPts[i] + 1;
     }
 
-    free(endPts);
-    free(flags);
+    if (!outl->tmp) {
+        free(endPts);
+        free(flags);
+    }
     return 0;
 failure:
-    free(endPts);
-    free(flags);
+    if (!outl->tmp) {
+        free(endPts);
+        free(flags);
+    }
     return -1;
 }
 
@@ -1458,3 +1613,178 @@ render_outline(Outline *outl, double transform[6], SFT_Image image) {
     free(cells);
     return 0;
 }
+
+/* Converts the points to 16.16 pixel coordinates. The scale factors are tiny, so the matrix keeps 32 fractional bits
+ * and the font units keep 6. */
+static void
+transform_points_fixed(unsigned int numPts, const Point *points, FixedPoint *out, double trf[6]) {
+    int64_t m0 = (int64_t) (trf[0] * 4294967296.0);
+    int64_t m1 = (int64_t) (trf[1] * 4294967296.0);
+    int64_t m2 = (int64_t) (trf[2] * 4294967296.0);
+    int64_t m3 = (int64_t) (trf[3] * 4294967296.0);
+    int32_t t4 = (int32_t) (trf[4] * FIX_ONE);
+    int32_t t5 = (int32_t) (trf[5] * FIX_ONE);
+    unsigned int i;
+    for (i = 0; i < numPts; ++i) {
+        int64_t x = (int64_t) (points[i].x * 64.0);
+        int64_t y = (int64_t) (points[i].y * 64.0);
+        out[i].x  = (int32_t) ((x * m0 + y * m2) >> 22) + t4;
+        out[i].y  = (int32_t) ((x * m1 + y * m3) >> 22) + t5;
+    }
+}
+
+static void
+clip_points_fixed(unsigned int numPts, FixedPoint *points, int width, int height) {
+    int32_t maxX = (width << FIX_SHIFT) - 1;
+    int32_t maxY = (height << FIX_SHIFT) - 1;
+    unsigned int i;
+    for (i = 0; i < numPts; ++i) {
+        if (points[i].x < 0)
+            points[i].x = 0;
+        if (points[i].x > maxX)
+            points[i].x = maxX;
+        if (points[i].y < 0)
+            points[i].y = 0;
+        if (points[i].y > maxY)
+            points[i].y = maxY;
+    }
+}
+
+/* Same heuristic as is_flat, the area of 16.16 coordinates is scaled by 2^32. */
+static int
+is_flat_fixed(const FixedPoint *points, Curve curve) {
+    const int64_t maxArea2 = (int64_t) 2 << 32;
+    FixedPoint a           = points[curve.beg];
+    FixedPoint b           = points[curve.ctrl];
+    FixedPoint c           = points[curve.end];
+    int64_t area2          = (int64_t) (b.x - a.x) * (c.y - a.y) - (int64_t) (c.x - a.x) * (b.y - a.y);
+    return (area2 < 0 ? -area2 : area2) <= maxArea2;
+}
+
+static int
+add_point_fixed(FixedOutline *fixed, FixedPoint a, FixedPoint b, uint_least16_t *index) {
+    if (fixed->numPoints >= fixed->capPoints)
+        return -1;
+    *index                           = fixed->numPoints;
+    fixed->points[fixed->numPoints++] = (FixedPoint){(int32_t) (((int64_t) a.x + b.x) >> 1), (int32_t) (((int64_t) a.y + b.y) >> 1)};
+    return 0;
+}
+
+static int
+tesselate_curves_fixed(Outline *outl, FixedOutline *fixed) {
+#define STACK_SIZE 10
+    Curve stack[STACK_SIZE];
+    unsigned int i, top;
+    for (i = 0; i < outl->numCurves; ++i) {
+        Curve curve = outl->curves[i];
+        top         = 0;
+        for (;;) {
+            if (is_flat_fixed(fixed->points, curve) || top >= STACK_SIZE) {
+                if (outl->numLines >= outl->capLines)
+                    return -1;
+                outl->lines[outl->numLines++] = (Line){curve.beg, curve.end};
+                if (top == 0) break;
+                curve = stack[--top];
+            } else {
+                uint_least16_t ctrl0, ctrl1, pivot;
+                if (add_point_fixed(fixed, fixed->points[curve.beg], fixed->points[curve.ctrl], &ctrl0) < 0 ||
+                    add_point_fixed(fixed, fixed->points[curve.ctrl], fixed->points[curve.end], &ctrl1) < 0 ||
+                    add_point_fixed(fixed, fixed->points[ctrl0], fixed->points[ctrl1], &pivot) < 0)
+                    return -1;
+                stack[top++] = (Curve){curve.beg, pivot, ctrl0};
+                curve        = (Curve){pivot, curve.end, ctrl1};
+            }
+        }
+    }
+    return 0;
+#undef STACK_SIZE
+}
+
+static inline void
+add_cell_fixed(FixedCell *cell, int column, int32_t x0, int32_t x1, int32_t dy) {
+    int32_t xAverage = ((x0 + x1) >> 1) - (column << FIX_SHIFT);
+    cell->cover += dy;
+    cell->area += (int32_t) (((int64_t) (FIX_ONE - xAverage) * dy) >> FIX_SHIFT);
+}
+
+/* Adds a line segment that stays within one row. ya < yb, sign is the direction of the original line. */
+static void
+draw_row_segment_fixed(FixedCell *row, int32_t xa, int32_t ya, int32_t xb, int32_t yb, int32_t sign) {
+    int column, dirX;
+    int32_t x, y, dx;
+    int64_t dydx;
+
+    if ((xa >> FIX_SHIFT) == (xb >> FIX_SHIFT)) {
+        column = xa >> FIX_SHIFT;
+        add_cell_fixed(&row[column], column, xa, xb, sign * (yb - ya));
+        return;
+    }
+
+    /* Walk along the columns, the y at each column boundary is interpolated.
+     * The last piece always ends at yb, so the cover of the row adds up exactly. */
+    dirX   = xb > xa ? 1 : -1;
+    dx     = xb > xa ? xb - xa : xa - xb;
+    dydx   = (int64_t) (yb - ya) * FIX_ONE / dx;
+    column = dirX > 0 ? xa >> FIX_SHIFT : (xa - 1) >> FIX_SHIFT;
+    x      = xa;
+    y      = ya;
+    for (;;) {
+        int32_t edge = dirX > 0 ? (column + 1) << FIX_SHIFT : column << FIX_SHIFT;
+        int last     = dirX > 0 ? xb <= edge : xb >= edge;
+        int32_t xEnd = last ? xb : edge;
+        int32_t yEnd = last ? yb : ya + (int32_t) (((int64_t) (dirX > 0 ? xEnd - xa : xa - xEnd) * dydx) >> FIX_SHIFT);
+        if (yEnd > yb)
+            yEnd = yb;
+        add_cell_fixed(&row[column], column, x, xEnd, sign * (yEnd - y));
+        if (last)
+            break;
+        x = xEnd;
+        y = yEnd;
+        column += dirX;
+    }
+}
+
+/* Draws a line into the buffer one row at a time. Rows are split at exact pixel boundaries,
+ * so the cover of every closed outline adds up to zero in each row. */
+static void
+draw_line_fixed(FixedRaster buf, FixedPoint origin, FixedPoint goal) {
+    int32_t sign = 1, rowY, xPrev, yPrev;
+    int64_t dxdy;
+
+    if (origin.y == goal.y)
+        return;
+    if (origin.y > goal.y) {
+        FixedPoint tmp = origin;
+        origin         = goal;
+        goal           = tmp;
+        sign           = -1;
+    }
+
+    dxdy  = (int64_t) (goal.x - origin.x) * FIX_ONE / (goal.y - origin.y);
+    rowY  = origin.y & ~(FIX_ONE - 1);
+    xPrev = origin.x;
+    yPrev = origin.y;
+    while (yPrev < goal.y) {
+        int32_t yNext = MIN(rowY + FIX_ONE, goal.y);
+        int32_t xNext = yNext == goal.y ? goal.x : origin.x + (int32_t) (((int64_t) (yNext - origin.y) * dxdy) >> FIX_SHIFT);
+        draw_row_segment_fixed(&buf.cells[(rowY >> FIX_SHIFT) * buf.width], xPrev, yPrev, xNext, yNext, sign);
+        xPrev = xNext;
+        yPrev = yNext;
+        rowY += FIX_ONE;
+    }
+}
+
+/* Integrate the values in the buffer to arrive at the final grayscale image. */
+static void
+post_process_fixed(FixedRaster buf, uint8_t *image) {
+    int32_t accum = 0, value;
+    unsigned int i, num;
+    num = (unsigned int) buf.width * (unsigned int) buf.height;
+    for (i = 0; i < num; ++i) {
+        value    = accum + buf.cells[i].area;
+        value    = value < 0 ? -value : value;
+        value    = MIN(value, FIX_ONE);
+        image[i] = (uint8_t) ((value * 255 + FIX_ONE / 2) >> FIX_SHIFT);
+        accum += buf.cells[i].cover;
+    }
+}
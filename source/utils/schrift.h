@@ -80,6 +80,9 @@ int sft_gmetrics(const SFT *sft, SFT_Glyph glyph, SFT_GMetrics *metrics);
 int sft_kerning(const SFT *sft, SFT_Glyph leftGlyph, SFT_Glyph rightGlyph,
                 SFT_Kerning *kerning);
 int sft_render(const SFT *sft, SFT_Glyph glyph, SFT_Image image);
+/* Same as sft_render, but with 16.16 fixed-point geometry and without any heap allocations.
+ * All temporary data is placed in scratch. Returns -1 if the glyph doesn't fit, fall back to sft_render then. */
+int sft_render_fixed(const SFT *sft, SFT_Glyph glyph, SFT_Image image, void *scratch, size_t scratchSize);
 
 #ifdef __cplusplus
 }
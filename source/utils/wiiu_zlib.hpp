@@ -17,15 +17,28 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ****************************************************************************/
 
+#include "elfio/elf_types.hpp"
 #include "elfio/elfio_utils.hpp"
 #include "logger.h"
 #include "utils.h"
+#include <coreinit/time.h>
 #include <memory>
 #include <zlib.h>
 
+// Sums up all sections inflated by a reader, see BootReport.
+struct InflateStats {
+    uint32_t compressedBytes   = 0;
+    uint32_t uncompressedBytes = 0;
+    OSTime ticks               = 0;
+};
+
 class wiiu_zlib : public ELFIO::compression_interface {
 public:
+    explicit wiiu_zlib(InflateStats *stats = nullptr) : mStats(stats) {
+    }
+
     std::unique_ptr<char[]> inflate(const char *data, const ELFIO::endianess_convertor *convertor, ELFIO::Elf_Xword compressed_size, ELFIO::Elf_Xword &uncompressed_size) const override {
+        OSTime start = OSGetTime();
         read_uncompressed_size(data, convertor, uncompressed_size);
         auto result = make_unique_nothrow<char[]>((uint32_t) (uncompressed_size + 1));
         if (result == nullptr) {
@@ -56,6 +69,11 @@ public:
         }
 
         result[uncompressed_size] = '\0';
+        if (mStats) {
+            mStats->compressedBytes += compressed_size;
+            mStats->uncompressedBytes += uncompressed_size;
+            mStats->ticks += OSGetTime() - start;
+        }
         return result;
     }
 
@@ -96,6 +114,8 @@ public:
     }
 
 private:
+    InflateStats *mStats;
+
     static void read_uncompressed_size(const char *&data, const ELFIO::endianess_convertor *convertor, ELFIO::Elf_Xword &uncompressed_size) {
         union _int32buffer {
             uint32_t word;
@@ -0,0 +1,211 @@
+// Host test and benchmark for source/utils/BlendKernels.cpp (integer fallback, built without ESPRESSO).
+// Compares the kernels against the float blending DrawUtils used before, r * opacity + dst * (1 - opacity).
+#include "utils/BlendKernels.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define MAX_CHANNEL_DIFF 1
+
+namespace {
+    uint32_t failures = 0;
+
+    uint32_t Pixel(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+        return (r << 24) | (g << 16) | (b << 8) | a;
+    }
+
+    uint32_t Channel(uint32_t pixel, uint32_t index) {
+        return (pixel >> (24 - index * 8)) & 0xFF;
+    }
+
+    // The old DrawUtils::drawPixel
+    uint32_t ReferenceBlend(uint32_t dst, uint32_t color, uint8_t a) {
+        if (a == 0xFF) {
+            return (color & 0xFFFFFF00) | (dst & 0xFF);
+        }
+        float opacity   = a / 255.0f;
+        uint32_t result = dst & 0xFF;
+        for (uint32_t c = 0; c < 3; c++) {
+            auto value = (uint8_t) (Channel(color, c) * opacity + Channel(dst, c) * (1 - opacity));
+            result |= value << (24 - c * 8);
+        }
+        return result;
+    }
+
+    // The old draw_freetype_bitmap passed font_col.a * coverage / 255 to drawPixel
+    uint32_t ReferenceCoverage(uint32_t dst, uint32_t color, uint8_t alpha, uint8_t coverage) {
+        float opacity = coverage / 255.0f;
+        return ReferenceBlend(dst, color, (uint8_t) (alpha * opacity));
+    }
+
+    // Straight alpha image pixel drawn with the old drawPixel, the kernel gets it premultiplied like ImageSurface does.
+    uint32_t Premultiply(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+        if (a != 0xFF) {
+            r = (r * a + 127) / 255;
+            g = (g * a + 127) / 255;
+            b = (b * a + 127) / 255;
+        }
+        return Pixel(r, g, b, a);
+    }
+
+    void Check(const char *name, uint32_t actual, uint32_t expected, uint32_t a, uint32_t b) {
+        bool ok = (actual & 0xFF) == (expected & 0xFF);
+        for (uint32_t c = 0; c < 3; c++) {
+            if (abs((int32_t) Channel(actual, c) - (int32_t) Channel(expected, c)) > MAX_CHANNEL_DIFF) {
+                ok = false;
+            }
+        }
+        if (!ok && failures++ < 10) {
+            printf("%s(%u, %u): got %08X, expected %08X\n", name, a, b, actual, expected);
+        }
+    }
+
+    // Channel values that cover the extremes and everything in between.
+    const uint32_t CHANNEL_SAMPLES[] = {0, 1, 2, 17, 64, 127, 128, 129, 200, 253, 254, 255};
+
+    void TestFillSpan() {
+        std::vector<uint32_t> dst(256);
+        for (uint32_t alpha = 0; alpha <= 255; alpha++) {
+            for (uint32_t s : CHANNEL_SAMPLES) {
+                uint32_t color = Pixel(s, 255 - s, s / 2, 0xFF);
+                for (uint32_t d = 0; d <= 255; d++) {
+                    dst[d] = Pixel(d, 255 - d, (d * 7) & 0xFF, d);
+                }
+                BlendKernels::FillSpan(dst.data(), dst.size(), color, alpha);
+                for (uint32_t d = 0; d <= 255; d++) {
+                    Check("FillSpan", dst[d], ReferenceBlend(Pixel(d, 255 - d, (d * 7) & 0xFF, d), color, alpha), alpha, d);
+                }
+            }
+        }
+    }
+
+    void TestBlendCoverageSpan() {
+        std::vector<uint8_t> coverage(256);
+        std::vector<uint32_t> dst(256);
+        for (uint32_t i = 0; i <= 255; i++) {
+            coverage[i] = i;
+        }
+        for (uint32_t alpha = 0; alpha <= 255; alpha++) {
+            for (uint32_t s : CHANNEL_SAMPLES) {
+                for (uint32_t d : CHANNEL_SAMPLES) {
+                    uint32_t color    = Pixel(s, 255 - s, s / 2, 0xFF);
+                    uint32_t original = Pixel(d, 255 - d, 255 - d / 2, 0x80);
+                    for (auto &px : dst) {
+                        px = original;
+                    }
+                    BlendKernels::BlendCoverageSpan(dst.data(), coverage.data(), coverage.size(), color, alpha);
+                    for (uint32_t i = 0; i <= 255; i++) {
+                        Check("BlendCoverageSpan", dst[i], ReferenceCoverage(original, color, alpha, i), alpha, i);
+                    }
+                }
+            }
+        }
+    }
+
+    void TestBlitSpan() {
+        std::vector<uint32_t> src(256);
+        std::vector<uint32_t> dst(256);
+        for (uint32_t s : CHANNEL_SAMPLES) {
+            for (uint32_t d : CHANNEL_SAMPLES) {
+                uint32_t straight = Pixel(s, 255 - s, s / 2, 0);
+                uint32_t original = Pixel(d, 255 - d, 255 - d / 2, 0x80);
+                for (uint32_t a = 0; a <= 255; a++) {
+                    src[a] = Premultiply(s, 255 - s, s / 2, a);
+                    dst[a] = original;
+                }
+                BlendKernels::BlitSpan(dst.data(), src.data(), src.size());
+                for (uint32_t a = 0; a <= 255; a++) {
+                    Check("BlitSpan", dst[a], ReferenceBlend(original, straight, a), s, a);
+                }
+            }
+        }
+    }
+
+    // Spans of every length up to 8 must not touch pixels outside of them.
+    void TestSpanEdges() {
+        uint8_t coverage[8] = {255, 128, 1, 0, 255, 64, 200, 255};
+        uint32_t src[8];
+        for (uint32_t i = 0; i < 8; i++) {
+            src[i] = Premultiply(255, 0, 128, coverage[i]);
+        }
+        for (uint32_t count = 0; count <= 8; count++) {
+            uint32_t buffers[3][10];
+            for (auto &buffer : buffers) {
+                for (auto &px : buffer) {
+                    px = 0x11223344;
+                }
+            }
+            BlendKernels::FillSpan(&buffers[0][1], count, 0xFF0080FF, 0x80);
+            BlendKernels::BlendCoverageSpan(&buffers[1][1], coverage, count, 0xFF0080FF, 0xFF);
+            BlendKernels::BlitSpan(&buffers[2][1], src, count);
+            for (auto &buffer : buffers) {
+                if (buffer[0] != 0x11223344 || buffer[count + 1] != 0x11223344) {
+                    if (failures++ < 10) {
+                        printf("Span of %u pixels wrote outside of its bounds\n", count);
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename F>
+    void Benchmark(const char *name, uint32_t pixels, F &&f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        printf("%-18s %8.3f ms, %6.3f ns/pixel\n", name, ns / 1e6, (double) ns / pixels);
+    }
+
+    void RunBenchmarks() {
+        constexpr uint32_t WIDTH = 854, ROUNDS = 2000;
+        std::vector<uint32_t> dst(WIDTH, 0x20304080);
+        std::vector<uint32_t> src(WIDTH);
+        std::vector<uint8_t> coverage(WIDTH);
+        for (uint32_t i = 0; i < WIDTH; i++) {
+            coverage[i] = (i * 37) & 0xFF;
+            src[i]      = Premultiply(i & 0xFF, 255 - (i & 0xFF), 128, coverage[i]);
+        }
+        Benchmark("FillSpan", WIDTH * ROUNDS, [&]() {
+            for (uint32_t r = 0; r < ROUNDS; r++) {
+                BlendKernels::FillSpan(dst.data(), WIDTH, 0xFF8000FF, 0x80 + (r & 1));
+            }
+        });
+        Benchmark("BlendCoverageSpan", WIDTH * ROUNDS, [&]() {
+            for (uint32_t r = 0; r < ROUNDS; r++) {
+                BlendKernels::BlendCoverageSpan(dst.data(), coverage.data(), WIDTH, 0xFF8000FF, 0xFF - (r & 1));
+            }
+        });
+        Benchmark("BlitSpan", WIDTH * ROUNDS, [&]() {
+            for (uint32_t r = 0; r < ROUNDS; r++) {
+                BlendKernels::BlitSpan(dst.data(), src.data(), WIDTH);
+            }
+        });
+        Benchmark("float reference", WIDTH * ROUNDS, [&]() {
+            for (uint32_t r = 0; r < ROUNDS; r++) {
+                for (uint32_t i = 0; i < WIDTH; i++) {
+                    dst[i] = ReferenceCoverage(dst[i], 0xFF8000FF, 0xFF - (r & 1), coverage[i]);
+                }
+            }
+        });
+        // Keep the results alive
+        printf("checksum %08X\n", dst[WIDTH / 2]);
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    TestFillSpan();
+    TestBlendCoverageSpan();
+    TestBlitSpan();
+    TestSpanEdges();
+    if (failures) {
+        printf("blend_kernels_test: %u failures\n", failures);
+        return 1;
+    }
+    printf("blend_kernels_test: passed\n");
+
+    if (argc > 1 && argv[1][0] == 'b') {
+        RunBenchmarks();
+    }
+    return 0;
+}
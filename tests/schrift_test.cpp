@@ -0,0 +1,183 @@
+// Host test for sft_render_fixed in source/utils/schrift.c.
+// Renders every glyph of a font with the fixed-point rasterizer and with the double precision sft_render, at the
+// sizes the loader uses, and compares the coverage. The loader uses the system font of the console, which isn't part
+// of this repository, so the font is passed as argument (any TrueType font works, e.g. a dump of CafeStd.ttf).
+#include "utils/schrift.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+// Same as GLYPH_SCRATCH_SIZE in DrawUtils.cpp
+#define SCRATCH_SIZE (96 * 1024)
+// Rounding differences only, an edge in the wrong place shows up as a much larger difference.
+#define MAX_COVERAGE_DIFF 2
+
+namespace {
+    const uint32_t FONT_SIZES[] = {12, 16, 20, 24, 32, 48, 64};
+
+    uint32_t failures = 0;
+
+    struct CompareResult {
+        uint32_t glyphs    = 0;
+        uint32_t fallbacks = 0;
+        uint32_t pixels    = 0;
+        uint32_t different = 0;
+        int maxDiff        = 0;
+    };
+
+    std::vector<uint8_t> LoadFile(const char *path) {
+        std::vector<uint8_t> data;
+        FILE *f = fopen(path, "rb");
+        if (!f) {
+            return data;
+        }
+        fseek(f, 0, SEEK_END);
+        data.resize(ftell(f));
+        fseek(f, 0, SEEK_SET);
+        if (fread(data.data(), 1, data.size(), f) != data.size()) {
+            data.clear();
+        }
+        fclose(f);
+        return data;
+    }
+
+    // The glyph set is every character DrawUtils can draw: printable ASCII and Latin-1.
+    std::vector<SFT_Glyph> LookupGlyphs(const SFT &sft) {
+        std::vector<SFT_Glyph> glyphs;
+        for (SFT_UChar c = 0x20; c <= 0xFF; c++) {
+            SFT_Glyph glyph;
+            if ((c < 0x7F || c >= 0xA0) && sft_lookup(&sft, c, &glyph) == 0 && glyph != 0) {
+                glyphs.push_back(glyph);
+            }
+        }
+        return glyphs;
+    }
+
+    void CompareGlyphs(SFT sft, const std::vector<SFT_Glyph> &glyphs, uint32_t size, std::vector<uint8_t> &scratch, CompareResult &result) {
+        sft.xScale = size;
+        sft.yScale = size;
+        std::vector<uint8_t> expected;
+        std::vector<uint8_t> actual;
+        for (auto glyph : glyphs) {
+            SFT_GMetrics mtx;
+            if (sft_gmetrics(&sft, glyph, &mtx) < 0) {
+                continue;
+            }
+            // Same padding as DrawUtils
+            int width  = (mtx.minWidth + 3) & ~3;
+            int height = mtx.minHeight;
+            if (width == 0 || height == 0) {
+                continue;
+            }
+            expected.assign(width * height, 0);
+            actual.assign(width * height, 0);
+            if (sft_render(&sft, glyph, {expected.data(), width, height}) < 0) {
+                printf("sft_render failed for glyph %lu at size %u\n", (unsigned long) glyph, size);
+                failures++;
+                continue;
+            }
+            result.glyphs++;
+            if (sft_render_fixed(&sft, glyph, {actual.data(), width, height}, scratch.data(), scratch.size()) < 0) {
+                // Too complex for the scratch buffer, DrawUtils falls back to sft_render then.
+                result.fallbacks++;
+                continue;
+            }
+
+            uint32_t different = 0;
+            int maxDiff        = 0;
+            for (size_t i = 0; i < expected.size(); i++) {
+                int diff = abs((int) actual[i] - (int) expected[i]);
+                if (diff != 0) {
+                    different++;
+                }
+                if (diff > maxDiff) {
+                    maxDiff = diff;
+                }
+            }
+            if (maxDiff > MAX_COVERAGE_DIFF && failures++ < 10) {
+                printf("glyph %lu at size %u: max coverage difference %d, %u of %zu pixels differ\n", (unsigned long) glyph, size, maxDiff, different,
+                       expected.size());
+            }
+            result.pixels += expected.size();
+            result.different += different;
+            if (maxDiff > result.maxDiff) {
+                result.maxDiff = maxDiff;
+            }
+        }
+    }
+
+    template<typename Render>
+    double BenchGlyphs(SFT sft, const std::vector<SFT_Glyph> &glyphs, uint32_t size, Render render) {
+        sft.xScale = size;
+        sft.yScale = size;
+        std::vector<uint8_t> pixels;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t repeat = 0; repeat < 20; repeat++) {
+            for (auto glyph : glyphs) {
+                SFT_GMetrics mtx;
+                if (sft_gmetrics(&sft, glyph, &mtx) < 0 || mtx.minWidth == 0 || mtx.minHeight == 0) {
+                    continue;
+                }
+                int width  = (mtx.minWidth + 3) & ~3;
+                int height = mtx.minHeight;
+                pixels.assign(width * height, 0);
+                render(sft, glyph, SFT_Image{pixels.data(), width, height});
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count() / (20.0 * glyphs.size());
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s <font.ttf> [bench]\n", argv[0]);
+        return 1;
+    }
+    auto fontData = LoadFile(argv[1]);
+    if (fontData.empty()) {
+        printf("Failed to read %s\n", argv[1]);
+        return 1;
+    }
+
+    SFT sft   = {};
+    sft.flags = SFT_DOWNWARD_Y;
+    sft.font  = sft_loadmem(fontData.data(), fontData.size());
+    if (!sft.font) {
+        printf("Failed to load %s\n", argv[1]);
+        return 1;
+    }
+
+    auto glyphs = LookupGlyphs(sft);
+    std::vector<uint8_t> scratch(SCRATCH_SIZE);
+    for (auto size : FONT_SIZES) {
+        CompareResult result;
+        CompareGlyphs(sft, glyphs, size, scratch, result);
+        printf("size %2u: %u glyphs, %u fallbacks, max coverage difference %d, %.3f%% of %u pixels differ\n", size, result.glyphs, result.fallbacks,
+               result.maxDiff, result.pixels ? result.different * 100.0 / result.pixels : 0.0, result.pixels);
+        // The loader relies on the fixed point path for the common glyphs, a fallback for most of them is a bug too.
+        if (result.fallbacks * 2 > result.glyphs) {
+            printf("size %u: sft_render_fixed gave up on %u of %u glyphs\n", size, result.fallbacks, result.glyphs);
+            failures++;
+        }
+    }
+
+    if (argc > 2 && std::string_view(argv[2]) == "bench") {
+        for (auto size : FONT_SIZES) {
+            auto doubleUs = BenchGlyphs(sft, glyphs, size, [](SFT &s, SFT_Glyph g, SFT_Image img) { sft_render(&s, g, img); });
+            auto fixedUs  = BenchGlyphs(sft, glyphs, size, [&scratch](SFT &s, SFT_Glyph g, SFT_Image img) { sft_render_fixed(&s, g, img, scratch.data(), scratch.size()); });
+            printf("size %2u: sft_render %.2f us/glyph, sft_render_fixed %.2f us/glyph\n", size, doubleUs, fixedUs);
+        }
+    }
+
+    sft_freefont(sft.font);
+
+    if (failures != 0) {
+        printf("schrift_test: %u failures\n", failures);
+        return 1;
+    }
+    printf("schrift_test: all tests passed\n");
+    return 0;
+}